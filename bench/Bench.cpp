@@ -0,0 +1,638 @@
+#include "Corpus.h"
+#include "Renderer.h"
+#include "ByteScan.h"
+#include "BlockIndex.h"
+#include "RenderServer.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <pthread.h>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#ifndef MDMNI_BUILD_TYPE
+#define MDMNI_BUILD_TYPE ""
+#endif
+
+// Every heap allocation in the process, for --allocs; atomic because --serve
+// runs threads
+static std::atomic<size_t> allocationCount{0};
+
+void* operator new(std::size_t n) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+
+// Swallows rendered output, keeping only its size
+class CountingStreamBuf : public std::streambuf {
+public:
+    size_t count = 0;
+
+protected:
+    std::streamsize xsputn(const char*, std::streamsize n) override {
+        count += static_cast<size_t>(n);
+        return n;
+    }
+    int_type overflow(int_type c) override {
+        if (c != traits_type::eof()) ++count;
+        return traits_type::not_eof(c);
+    }
+};
+
+struct Settings {
+    size_t bytes = 4 * 1024 * 1024;
+    unsigned repeat = 3;
+    uint64_t seed = 1;
+    int wrap = 0;
+    bool urls = true;
+    bool allocs = false;
+    unsigned edits = 0;
+    bool linear = false;
+    unsigned serveRequests = 0;
+    unsigned clients = 4;
+    bool sizeSet = false;
+    std::vector<std::string> corpusNames;
+    std::vector<mdmni::CorpusKind> corpora;
+    std::vector<const mdmni::AdversarialInput*> adversarial;
+    std::vector<bool> colors = { true, false };
+};
+
+long peakRssKb() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+long minorFaults() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_minflt;
+}
+
+// Generate one corpus, render it repeat times and print a JSON record of the
+// fastest run. Runs in its own process so peak RSS belongs to this case alone.
+void runCase(const Settings& s, mdmni::CorpusKind kind, bool color) {
+    std::string doc = mdmni::generateCorpus(kind, s.bytes, s.seed);
+    size_t lines = static_cast<size_t>(std::count(doc.begin(), doc.end(), '\n'));
+    long baseRss = peakRssKb();
+
+    double best = 0;
+    size_t outBytes = 0;
+    size_t allocations = 0;
+    long faults = 0;
+    for (unsigned i = 0; i < s.repeat; ++i) {
+        CountingStreamBuf buf;
+        std::ostream out(&buf);
+        mdmni::MemoryInput in(doc);
+        mdmni::RenderOptions opts;
+        opts.useColor = color;
+        opts.showUrls = s.urls;
+        opts.wrap = s.wrap;
+        mdmni::Renderer r(opts);
+
+        size_t allocsBefore = allocationCount;
+        long faultsBefore = minorFaults();
+        auto start = std::chrono::steady_clock::now();
+        r.render(in, out);
+        std::chrono::duration<double> took = std::chrono::steady_clock::now() - start;
+        if (i == 0 || took.count() < best) best = took.count();
+        outBytes = buf.count;
+        allocations = allocationCount - allocsBefore;
+        faults = minorFaults() - faultsBefore;
+    }
+    if (best <= 0) best = 1e-9;
+
+    std::printf("{\"corpus\":\"%s\",\"color\":%s,\"input_bytes\":%zu,\"lines\":%zu,"
+                "\"output_bytes\":%zu,\"seconds\":%.6f,\"mb_per_s\":%.2f,\"lines_per_s\":%.0f,"
+                "\"allocations\":%zu,\"minor_faults\":%ld,\"base_rss_kb\":%ld,\"peak_rss_kb\":%ld}\n",
+                mdmni::corpusName(kind), color ? "true" : "false", doc.size(), lines,
+                outBytes, best, doc.size() / best / (1024 * 1024), lines / best,
+                allocations, faults, baseRss, peakRssKb());
+}
+
+// Snippets of a few KiB cut from doc at blank lines
+std::vector<std::string_view> cutSnippets(std::string_view doc) {
+    std::vector<std::string_view> snippets;
+    size_t start = 0;
+    while (start < doc.size()) {
+        size_t cut = doc.find("\n\n", start + 1024);
+        size_t end = cut == std::string::npos ? doc.size() : cut + 2;
+        snippets.push_back(doc.substr(start, end - start));
+        start = end;
+    }
+    return snippets;
+}
+
+// Render many small snippets with one Renderer and one output string, the
+// way an embedding service would, and count heap allocations once both have
+// grown to fit. Exits with status 1 if steady-state rendering allocates.
+void runAllocCheck(const Settings& s, bool color) {
+    std::string doc = mdmni::generateCorpus(mdmni::CorpusKind::Mixed, 512 * 1024, s.seed);
+    std::vector<std::string_view> snippets = cutSnippets(doc);
+
+    mdmni::RenderOptions opts;
+    opts.useColor = color;
+    opts.showUrls = s.urls;
+    opts.wrap = s.wrap;
+    mdmni::Renderer r(opts);
+    std::string out;
+    for (std::string_view snippet : snippets) {
+        out.clear();
+        r.render(snippet, out);
+    }
+
+    size_t before = allocationCount.load();
+    size_t renders = 0;
+    auto begin = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < s.repeat; ++i) {
+        for (std::string_view snippet : snippets) {
+            out.clear();
+            r.reset();
+            r.render(snippet, out);
+            ++renders;
+        }
+    }
+    std::chrono::duration<double> took = std::chrono::steady_clock::now() - begin;
+    size_t allocations = allocationCount.load() - before;
+
+    std::printf("{\"check\":\"allocs\",\"color\":%s,\"renders\":%zu,\"snippet_bytes\":%zu,"
+                "\"allocations\":%zu,\"renders_per_s\":%.0f}\n",
+                color ? "true" : "false", renders, doc.size() / snippets.size(),
+                allocations, renders / std::max(took.count(), 1e-9));
+    std::fflush(stdout);
+    if (allocations != 0) _exit(1);
+}
+
+// Start a render server on a local socket and have s.clients clients send it
+// the --allocs snippets, s.serveRequests each, timing every round trip. The
+// server's output is first compared with a local render of each snippet and
+// a document over the size limit must be refused; a mismatch or a failed
+// request exits with status 1.
+void runServeCheck(const Settings& s, bool color) {
+    std::string doc = mdmni::generateCorpus(mdmni::CorpusKind::Mixed, 512 * 1024, s.seed);
+    std::vector<std::string_view> snippets = cutSnippets(doc);
+    mdmni::RenderOptions opts;
+    opts.useColor = color;
+    opts.showUrls = s.urls;
+    opts.wrap = s.wrap;
+
+    const char* tmp = std::getenv("TMPDIR");
+    std::string path = std::string(tmp && *tmp ? tmp : "/tmp") + "/mdmni_bench." + std::to_string(getpid()) + ".sock";
+    unsigned workers = std::max(1u, std::thread::hardware_concurrency());
+    mdmni::RenderServer server(workers);
+    if (!server.listen(path)) {
+        std::perror("mdmni_bench: listen");
+        _exit(1);
+    }
+    std::thread loop([&] { server.run(); });
+    auto fail = [&](const char* what) {
+        std::fprintf(stderr, "mdmni_bench: serve: %s\n", what);
+        server.stop();
+        loop.join();
+        _exit(1);
+    };
+
+    {
+        mdmni::RenderClient client;
+        if (!client.connect(path)) fail("cannot connect");
+        mdmni::Renderer r(opts);
+        std::string expected;
+        std::string got;
+        for (std::string_view snippet : snippets) {
+            expected.clear();
+            r.reset();
+            r.render(snippet, expected);
+            if (!client.render(snippet, opts, got)) fail("request failed");
+            if (got != expected) fail("output differs from a local render");
+        }
+    }
+
+    // RenderClient refuses documents over the limit itself, so the server's
+    // own check is reached with a bare header claiming one
+    {
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        path.copy(addr.sun_path, sizeof addr.sun_path - 1);
+        if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0) fail("cannot connect");
+        // A server that waits for the body instead fails rather than hangs
+        timeval timeout{10, 0};
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof timeout);
+        unsigned char request[mdmni::ServeRequestHeaderBytes] = {};
+        uint32_t length = mdmni::ServeMaxDocumentBytes + 1;
+        for (int i = 0; i < 4; ++i) request[i] = static_cast<unsigned char>(length >> (8 * i));
+        unsigned char response[mdmni::ServeResponseHeaderBytes];
+        size_t got = 0;
+        ssize_t n = send(fd, request, sizeof request, MSG_NOSIGNAL);
+        while (n == static_cast<ssize_t>(sizeof request) && got < sizeof response) {
+            ssize_t r = recv(fd, response + got, sizeof response - got, 0);
+            if (r <= 0) break;
+            got += static_cast<size_t>(r);
+        }
+        close(fd);
+        if (got < sizeof response || response[0] != mdmni::ServeFailed) fail("oversized document was not refused");
+    }
+
+    // Each client keeps its own connection and latencies
+    std::vector<std::vector<double>> latencies(s.clients);
+    std::atomic<bool> failed{false};
+    std::vector<std::thread> clients;
+    auto begin = std::chrono::steady_clock::now();
+    for (unsigned c = 0; c < s.clients; ++c) {
+        clients.emplace_back([&, c] {
+            mdmni::RenderClient client;
+            if (!client.connect(path)) {
+                failed = true;
+                return;
+            }
+            std::vector<double>& mine = latencies[c];
+            mine.reserve(s.serveRequests);
+            std::string out;
+            for (unsigned i = 0; i < s.serveRequests; ++i) {
+                std::string_view snippet = snippets[(c * 7 + i) % snippets.size()];
+                auto start = std::chrono::steady_clock::now();
+                if (!client.render(snippet, opts, out)) {
+                    failed = true;
+                    return;
+                }
+                std::chrono::duration<double, std::micro> took = std::chrono::steady_clock::now() - start;
+                mine.push_back(took.count());
+            }
+        });
+    }
+    for (std::thread& t : clients) t.join();
+    std::chrono::duration<double> took = std::chrono::steady_clock::now() - begin;
+    if (failed) fail("request failed");
+    server.stop();
+    loop.join();
+
+    std::vector<double> all;
+    for (const std::vector<double>& l : latencies) all.insert(all.end(), l.begin(), l.end());
+    std::sort(all.begin(), all.end());
+    auto percentile = [&](size_t p) { return all[std::min(all.size() - 1, all.size() * p / 100)]; };
+    std::printf("{\"check\":\"serve\",\"color\":%s,\"clients\":%u,\"workers\":%u,\"requests\":%zu,"
+                "\"snippet_bytes\":%zu,\"p50_us\":%.1f,\"p99_us\":%.1f,\"max_us\":%.1f,\"requests_per_s\":%.0f}\n",
+                color ? "true" : "false", s.clients, workers, all.size(), doc.size() / snippets.size(),
+                percentile(50), percentile(99), all.back(), all.size() / std::max(took.count(), 1e-9));
+    std::fflush(stdout);
+}
+
+// Apply small random edits to a document, the way an editor saves it, and
+// follow each with what --watch does: update a BlockIndex incrementally and
+// render the segments it replaced. Every updated index is compared with a
+// fresh one; a mismatch exits with status 1.
+void runEditCheck(const Settings& s, mdmni::CorpusKind kind, bool color) {
+    static const char* const Snippets[] = { "x", " ", "\n", "\n\n", "# ", "```\n", "~~~~", "| a |", "- ", "> " };
+    std::string doc = mdmni::generateCorpus(kind, s.bytes, s.seed);
+    std::string next;
+    mdmni::BlockIndex index(doc);
+    index.extendAll();
+    mdmni::RenderOptions opts;
+    opts.useColor = color;
+    opts.showUrls = s.urls;
+    opts.wrap = s.wrap;
+    mdmni::Renderer r(opts);
+    std::string out;
+
+    uint64_t state = s.seed;
+    auto random = [&state]() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+        return z ^ (z >> 31);
+    };
+
+    std::vector<double> millis;
+    size_t segments = 0;
+    for (unsigned e = 0; e < s.edits; ++e) {
+        next = doc;
+        size_t pos = random() % (next.size() + 1);
+        if (random() % 3 == 0 && pos < next.size()) next.erase(pos, 1 + random() % 8);
+        else next.insert(pos, Snippets[random() % (sizeof Snippets / sizeof Snippets[0])]);
+
+        auto start = std::chrono::steady_clock::now();
+        mdmni::IndexEdit edit = index.update(next);
+        for (size_t i = edit.first; i < edit.first + edit.inserted; ++i) {
+            out.clear();
+            r.restoreFence(index.checkpoint(i).fence);
+            r.render(index.segment(i), out);
+        }
+        std::chrono::duration<double, std::milli> took = std::chrono::steady_clock::now() - start;
+        millis.push_back(took.count());
+        segments += edit.inserted;
+
+        mdmni::BlockIndex fresh(next);
+        fresh.extendAll();
+        bool same = fresh.segmentsKnown() == index.segmentsKnown() &&
+                    fresh.headings().size() == index.headings().size();
+        for (size_t i = 0; same && i < fresh.segmentsKnown(); ++i)
+            same = fresh.checkpoint(i).offset == index.checkpoint(i).offset &&
+                   fresh.checkpoint(i).fence == index.checkpoint(i).fence;
+        for (size_t i = 0; same && i < fresh.headings().size(); ++i)
+            same = fresh.headings()[i].offset == index.headings()[i].offset &&
+                   fresh.headings()[i].text == index.headings()[i].text;
+        if (!same) {
+            std::printf("{\"check\":\"edits\",\"corpus\":\"%s\",\"error\":\"index differs after edit %u at %zu\"}\n",
+                        mdmni::corpusName(kind), e, pos);
+            std::fflush(stdout);
+            _exit(1);
+        }
+        doc.swap(next);
+    }
+
+    std::sort(millis.begin(), millis.end());
+    auto at = [&](double q) { return millis.empty() ? 0.0 : millis[static_cast<size_t>(q * (millis.size() - 1))]; };
+    std::printf("{\"check\":\"edits\",\"corpus\":\"%s\",\"color\":%s,\"input_bytes\":%zu,"
+                "\"edits\":%u,\"segments_per_edit\":%.2f,\"p50_ms\":%.3f,\"p99_ms\":%.3f,\"max_ms\":%.3f}\n",
+                mdmni::corpusName(kind), color ? "true" : "false", doc.size(), s.edits,
+                s.edits ? static_cast<double>(segments) / s.edits : 0.0, at(0.5), at(0.99), at(1.0));
+}
+
+// Rendering must take linear time on any input and a bounded amount of
+// stack. Each adversarial input is rendered at sizes from 1 KiB up to 64 MiB
+// (or --size) on a thread with a small stack, unwrapped and wrapped. From
+// 64 KiB up, time per byte may grow at most LinearStep times from one size to
+// the next (4x) and LinearGrowth times overall; quadratic work approaches 4x
+// per step, and n^1.25 would exceed the overall limit by 64 MiB.
+// LinearFloorNs is added to every time first: cases that run at memory speed
+// slow down severalfold once the input leaves the caches. Exits with status 1
+// if a limit is broken.
+constexpr double LinearStep = 2.5;
+constexpr double LinearGrowth = 4.0;
+constexpr double LinearFloorNs = 1.0;
+constexpr size_t LinearStackBytes = 256 * 1024;
+
+struct LinearRun {
+    const Settings* settings;
+    const mdmni::AdversarialInput* input;
+    bool color;
+    int wrap;
+    bool passed;
+};
+
+void* linearRun(void* arg) {
+    LinearRun& run = *static_cast<LinearRun*>(arg);
+    const Settings& s = *run.settings;
+    size_t maxBytes = s.sizeSet ? s.bytes : 64 * 1024 * 1024;
+
+    mdmni::RenderOptions opts;
+    opts.useColor = run.color;
+    opts.showUrls = run.settings->urls;
+    opts.wrap = run.wrap;
+    mdmni::Renderer r(opts);
+    // Output is counted, not kept: some inputs expand thirtyfold
+    CountingStreamBuf buf;
+    std::ostream out(&buf);
+
+    std::vector<size_t> sizes;
+    std::vector<double> nsPerByte;
+    for (size_t n = 1024; n <= maxBytes; n *= 4) {
+        std::string doc = mdmni::generateAdversarial(*run.input, n);
+        // At least two runs, the first of which grows the renderer's buffers,
+        // and enough to time small sizes reliably
+        double best = 0;
+        double total = 0;
+        for (unsigned i = 0; i < 2 || (total < 0.05 && i < 10000); ++i) {
+            mdmni::MemoryInput in(doc);
+            auto start = std::chrono::steady_clock::now();
+            r.render(in, out);
+            std::chrono::duration<double> took = std::chrono::steady_clock::now() - start;
+            if (i == 0 || took.count() < best) best = took.count();
+            total += took.count();
+        }
+        sizes.push_back(doc.size());
+        nsPerByte.push_back(best * 1e9 / doc.size());
+    }
+
+    double lowest = 0;
+    double worstStep = 1.0;
+    for (size_t i = 0; i < sizes.size(); ++i) {
+        if (sizes[i] < 64 * 1024) continue;
+        if (lowest == 0 || nsPerByte[i] < lowest) lowest = nsPerByte[i];
+        if (i > 0 && sizes[i - 1] >= 64 * 1024)
+            worstStep = std::max(worstStep, (nsPerByte[i] + LinearFloorNs) / (nsPerByte[i - 1] + LinearFloorNs));
+    }
+    double growth = (nsPerByte.back() + LinearFloorNs) / (lowest + LinearFloorNs);
+    run.passed = growth <= LinearGrowth && worstStep <= LinearStep;
+
+    std::printf("{\"check\":\"linear\",\"input\":\"%s\",\"color\":%s,\"wrap\":%d,\"ns_per_byte\":{",
+                run.input->name, run.color ? "true" : "false", run.wrap);
+    for (size_t i = 0; i < sizes.size(); ++i)
+        std::printf("%s\"%zu\":%.2f", i ? "," : "", sizes[i], nsPerByte[i]);
+    std::printf("},\"growth\":%.2f,\"worst_step\":%.2f,\"passed\":%s}\n", growth, worstStep,
+                run.passed ? "true" : "false");
+    return nullptr;
+}
+
+void runLinearCheck(const Settings& s, const mdmni::AdversarialInput& input, bool color) {
+    for (int wrap : { 0, s.wrap > 0 ? s.wrap : 60 }) {
+        LinearRun run{ &s, &input, color, wrap, false };
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setstacksize(&attr, LinearStackBytes);
+        pthread_t thread;
+        if (pthread_create(&thread, &attr, linearRun, &run) != 0) {
+            std::perror("mdmni_bench: pthread_create");
+            _exit(1);
+        }
+        pthread_join(thread, nullptr);
+        pthread_attr_destroy(&attr);
+        std::fflush(stdout);
+        if (!run.passed) _exit(1);
+    }
+}
+
+void usageExit(int code) {
+    std::cout << "mdmni_bench - renderer throughput benchmark\n\n";
+    std::cout << "Usage: mdmni_bench [OPTIONS]\n";
+    std::cout << "Prints one JSON object per line: a header, then one record per corpus and color setting.\n\n";
+    std::cout << "Options:\n";
+    std::cout << "  -h, --help        Show this help message and exit\n";
+    std::cout << "  -s, --size MB     Size of each generated corpus (default 4)\n";
+    std::cout << "  -r, --repeat N    Render each corpus N times, report the fastest (default 3)\n";
+    std::cout << "      --seed N      Seed for the corpus generator (default 1)\n";
+    std::cout << "  -w, --wrap N      Render with wrapping to width N (default 0, no wrap)\n";
+    std::cout << "  -c, --corpus NAME Only run NAME (may be repeated; an input name with --linear)\n";
+    std::cout << "      --color MODE  on, off or both (default both)\n";
+    std::cout << "      --urls MODE   on or off: show link and image URLs (default on)\n";
+    std::cout << "      --simd LEVEL  Scan with scalar, sse2 or avx2 code (default: best available)\n";
+    std::cout << "      --dump NAME   Write corpus NAME to stdout and exit\n";
+    std::cout << "      --allocs      Check that rendering small snippets does not allocate\n";
+    std::cout << "      --edits N     Time N incremental re-renders after small edits (as --watch)\n";
+    std::cout << "      --serve N     Time N round trips per client to a render server on a local\n";
+    std::cout << "                    socket, reporting p50/p99 latency\n";
+    std::cout << "      --clients N   Concurrent clients for --serve (default 4)\n";
+    std::cout << "      --linear      Check that adversarial inputs up to --size (default 64) render in\n";
+    std::cout << "                    linear time and bounded stack\n\n";
+    std::cout << "Corpora:";
+    for (mdmni::CorpusKind k : mdmni::AllCorpusKinds)
+        std::cout << ' ' << mdmni::corpusName(k);
+    std::cout << '\n';
+    std::exit(code);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    Settings s;
+    bool dump = false;
+    mdmni::CorpusKind dumpKind = mdmni::CorpusKind::Mixed;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string a = argv[i];
+        bool hasValue = argc > i + 1;
+        if (a == "-h" || a == "--help") {
+            usageExit(0);
+        } else if ((a == "-s" || a == "--size") && hasValue) {
+            double mb = std::atof(argv[++i]);
+            if (mb <= 0) usageExit(2);
+            s.bytes = static_cast<size_t>(mb * 1024 * 1024);
+            s.sizeSet = true;
+        } else if ((a == "-r" || a == "--repeat") && hasValue) {
+            int n = std::atoi(argv[++i]);
+            if (n <= 0) usageExit(2);
+            s.repeat = static_cast<unsigned>(n);
+        } else if ((a == "-w" || a == "--wrap") && hasValue) {
+            s.wrap = std::atoi(argv[++i]);
+        } else if (a == "--seed" && hasValue) {
+            s.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if ((a == "-c" || a == "--corpus") && hasValue) {
+            s.corpusNames.push_back(argv[++i]);
+        } else if (a == "--color" && hasValue) {
+            std::string mode = argv[++i];
+            if (mode == "on") s.colors = { true };
+            else if (mode == "off") s.colors = { false };
+            else if (mode == "both") s.colors = { true, false };
+            else usageExit(2);
+        } else if (a == "--urls" && hasValue) {
+            std::string mode = argv[++i];
+            if (mode == "on") s.urls = true;
+            else if (mode == "off") s.urls = false;
+            else usageExit(2);
+        } else if (a == "--simd" && hasValue) {
+            mdmni::ScanLevel level;
+            if (!mdmni::parseScanLevel(argv[++i], level) || !mdmni::setScanLevel(level)) {
+                std::cerr << "mdmni_bench: " << argv[i] << " is not available\n";
+                return 2;
+            }
+        } else if (a == "--edits" && hasValue) {
+            int n = std::atoi(argv[++i]);
+            if (n <= 0) usageExit(2);
+            s.edits = static_cast<unsigned>(n);
+        } else if ((a == "--serve" || a == "--clients") && hasValue) {
+            int n = std::atoi(argv[++i]);
+            if (n <= 0) usageExit(2);
+            (a == "--serve" ? s.serveRequests : s.clients) = static_cast<unsigned>(n);
+        } else if (a == "--linear") {
+            s.linear = true;
+        } else if (a == "--allocs") {
+            s.allocs = true;
+        } else if (a == "--dump" && hasValue) {
+            if (!mdmni::parseCorpusKind(argv[++i], dumpKind)) {
+                std::cerr << "mdmni_bench: unknown corpus " << argv[i] << "\n";
+                return 2;
+            }
+            dump = true;
+        } else {
+            usageExit(2);
+        }
+    }
+
+    if (dump) {
+        std::string doc = mdmni::generateCorpus(dumpKind, s.bytes, s.seed);
+        std::fwrite(doc.data(), 1, doc.size(), stdout);
+        return std::ferror(stdout) ? 1 : 0;
+    }
+
+    // With --linear, -c names adversarial inputs instead
+    for (const std::string& name : s.corpusNames) {
+        mdmni::CorpusKind k;
+        const mdmni::AdversarialInput* input = nullptr;
+        for (size_t i = 0; i < mdmni::AdversarialInputCount; ++i)
+            if (name == mdmni::AdversarialInputs[i].name) input = &mdmni::AdversarialInputs[i];
+        if (s.linear ? !input : !mdmni::parseCorpusKind(name, k)) {
+            std::cerr << "mdmni_bench: unknown " << (s.linear ? "input " : "corpus ") << name << "\n";
+            return 2;
+        }
+        if (s.linear) s.adversarial.push_back(input);
+        else s.corpora.push_back(k);
+    }
+    if (s.linear && s.adversarial.empty()) {
+        for (size_t i = 0; i < mdmni::AdversarialInputCount; ++i)
+            s.adversarial.push_back(&mdmni::AdversarialInputs[i]);
+    }
+
+    if (s.allocs || s.serveRequests)
+        s.corpora = { mdmni::CorpusKind::Mixed };
+    else if (s.corpora.empty())
+        s.corpora.assign(std::begin(mdmni::AllCorpusKinds), std::end(mdmni::AllCorpusKinds));
+
+    std::printf("{\"bench\":\"render\",\"renderer_version\":%u,\"build\":\"%s\","
+                "\"corpus_bytes\":%zu,\"repeat\":%u,\"seed\":%llu,\"wrap\":%d,\"urls\":%s,\"simd\":\"%s\"}\n",
+                mdmni::RendererVersion, MDMNI_BUILD_TYPE, s.bytes, s.repeat,
+                static_cast<unsigned long long>(s.seed), s.wrap, s.urls ? "true" : "false",
+                mdmni::scanLevelName(mdmni::scanLevel()));
+    std::fflush(stdout);
+
+    int status = 0;
+    if (s.linear) {
+        for (const mdmni::AdversarialInput* input : s.adversarial) {
+            for (bool color : s.colors) {
+                pid_t pid = fork();
+                if (pid == 0) {
+                    runLinearCheck(s, *input, color);
+                    _exit(0);
+                }
+                int st = 0;
+                if (pid < 0 || waitpid(pid, &st, 0) < 0 || !WIFEXITED(st) || WEXITSTATUS(st) != 0) {
+                    std::cerr << "mdmni_bench: " << input->name << " run failed\n";
+                    status = 1;
+                }
+            }
+        }
+        return status;
+    }
+
+    for (mdmni::CorpusKind kind : s.corpora) {
+        for (bool color : s.colors) {
+            pid_t pid = fork();
+            if (pid == 0) {
+                if (s.allocs) runAllocCheck(s, color);
+                else if (s.serveRequests) runServeCheck(s, color);
+                else if (s.edits) runEditCheck(s, kind, color);
+                else runCase(s, kind, color);
+                std::fflush(stdout);
+                _exit(0);
+            }
+            int st = 0;
+            if (pid < 0 || waitpid(pid, &st, 0) < 0 || !WIFEXITED(st) || WEXITSTATUS(st) != 0) {
+                std::cerr << "mdmni_bench: " << mdmni::corpusName(kind) << " run failed\n";
+                status = 1;
+            }
+        }
+    }
+    return status;
+}
@@ -0,0 +1,316 @@
+#include "Corpus.h"
+
+namespace mdmni {
+
+namespace {
+
+const char* const Words[] = {
+    "the", "terminal", "renders", "markdown", "quickly", "while", "a", "reader",
+    "scrolls", "through", "long", "documents", "with", "tables", "and", "code",
+    "buffer", "stream", "of", "lines", "is", "split", "into", "blocks", "every",
+    "heading", "starts", "new", "section", "paragraph", "wraps", "at", "width",
+    "column", "pager", "output", "input", "file", "on", "disk", "in", "memory",
+    "fast", "simple", "viewer", "for", "plain", "text", "notes", "release",
+    "über", "naïve", "café", "日本語", "テキスト", "表示", "ширина", "строка",
+};
+constexpr size_t WordCount = sizeof(Words) / sizeof(Words[0]);
+
+const char* const Languages[] = { "cpp", "python", "sh", "json", "" };
+
+// splitmix64: tiny, fast and identical everywhere, unlike <random> distributions
+class Rng {
+public:
+    explicit Rng(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+    // Uniform in [lo, hi]
+    size_t range(size_t lo, size_t hi) { return lo + next() % (hi - lo + 1); }
+    bool chance(unsigned percent) { return next() % 100 < percent; }
+
+private:
+    uint64_t state;
+};
+
+class Generator {
+public:
+    Generator(std::string& out, uint64_t seed) : out(out), rng(seed) {}
+
+    void word() { out += Words[rng.next() % WordCount]; }
+
+    void words(size_t n) {
+        for (size_t i = 0; i < n; ++i) {
+            if (i) out += ' ';
+            word();
+        }
+    }
+
+    void url() {
+        out += "https://example.com/";
+        word();
+        out += '/';
+        out += std::to_string(rng.next() % 10000);
+    }
+
+    // One inline construct, or an unmatched delimiter now and then
+    void inlineSpan() {
+        switch (rng.next() % 9) {
+        case 0: out += "**"; words(rng.range(1, 3)); out += "**"; break;
+        case 1: out += '*'; words(rng.range(1, 3)); out += '*'; break;
+        case 2: out += "__"; words(rng.range(1, 2)); out += "__"; break;
+        case 3: out += '_'; word(); out += '_'; break;
+        case 4: out += '`'; words(rng.range(1, 3)); out += '`'; break;
+        case 5: out += '['; words(rng.range(1, 3)); out += "]("; url(); out += ')'; break;
+        case 6: out += "!["; words(rng.range(1, 2)); out += "]("; url(); out += ')'; break;
+        case 7: out += "a * b [c"; break;
+        default: out += "**"; word(); out += " `x*y` "; word(); out += "**"; break;
+        }
+    }
+
+    // A sentence; inlinePercent is the chance of each word being a construct
+    void sentence(unsigned inlinePercent) {
+        size_t n = rng.range(6, 18);
+        for (size_t i = 0; i < n; ++i) {
+            if (i) out += ' ';
+            if (rng.chance(inlinePercent))
+                inlineSpan();
+            else
+                word();
+        }
+        out += '.';
+    }
+
+    void paragraph(unsigned inlinePercent) {
+        size_t lines = rng.range(2, 8);
+        for (size_t i = 0; i < lines; ++i) {
+            sentence(inlinePercent);
+            out += ' ';
+            sentence(inlinePercent);
+            out += '\n';
+        }
+        out += '\n';
+    }
+
+    void heading() {
+        out.append(rng.range(1, 6), '#');
+        out += ' ';
+        words(rng.range(2, 6));
+        if (rng.chance(30)) {
+            out += ' ';
+            inlineSpan();
+        }
+        out += "\n\n";
+    }
+
+    void list() {
+        size_t items = rng.range(3, 20);
+        bool ordered = rng.chance(30);
+        for (size_t i = 0; i < items; ++i) {
+            out.append(2 * rng.range(0, 3), ' ');
+            if (ordered) {
+                out += std::to_string(i + 1) + ". ";
+            } else {
+                out += "-*+"[rng.next() % 3];
+                out += ' ';
+            }
+            sentence(20);
+            out += '\n';
+        }
+        out += '\n';
+    }
+
+    void quote() {
+        size_t lines = rng.range(2, 10);
+        for (size_t i = 0; i < lines; ++i) {
+            out += "> ";
+            sentence(15);
+            out += '\n';
+        }
+        out += '\n';
+    }
+
+    void table(size_t minRows, size_t maxRows) {
+        size_t cols = rng.range(3, 12);
+        size_t rows = rng.range(minRows, maxRows);
+        out += '|';
+        for (size_t c = 0; c < cols; ++c) {
+            out += ' ';
+            words(rng.range(1, 2));
+            out += " |";
+        }
+        out += "\n|";
+        for (size_t c = 0; c < cols; ++c)
+            out += "---|";
+        out += '\n';
+        for (size_t r = 0; r < rows; ++r) {
+            out += '|';
+            for (size_t c = 0; c < cols; ++c) {
+                out += ' ';
+                if (rng.chance(15))
+                    inlineSpan();
+                else
+                    words(rng.range(1, 4));
+                out += " |";
+            }
+            out += '\n';
+        }
+        out += '\n';
+    }
+
+    void fence(size_t minLines, size_t maxLines) {
+        bool tilde = rng.chance(20);
+        std::string marker(rng.range(3, 5), tilde ? '~' : '`');
+        out += marker;
+        out += Languages[rng.next() % (sizeof(Languages) / sizeof(Languages[0]))];
+        out += '\n';
+        size_t lines = rng.range(minLines, maxLines);
+        for (size_t i = 0; i < lines; ++i) {
+            out.append(4 * rng.range(0, 4), ' ');
+            // Markdown-looking content that must stay verbatim
+            switch (rng.next() % 6) {
+            case 0: out += "# not a heading"; break;
+            case 1: out += "| not | a | table |"; break;
+            case 2: out += "return **not_bold** * [x](y);"; break;
+            default: words(rng.range(2, 10)); out += ';'; break;
+            }
+            out += '\n';
+        }
+        out += marker;
+        out += "\n\n";
+    }
+
+    void rule() { out += "---\n\n"; }
+
+    // A paragraph line of several megabytes
+    void longLine() {
+        size_t target = out.size() + rng.range(2, 4) * 1024 * 1024;
+        while (out.size() < target) {
+            sentence(25);
+            out += ' ';
+        }
+        out += "\n\n";
+    }
+
+    void block(CorpusKind kind) {
+        switch (kind) {
+        case CorpusKind::Paragraphs: paragraph(2); break;
+        case CorpusKind::Inline: paragraph(60); break;
+        case CorpusKind::Headings: heading(); break;
+        case CorpusKind::Lists: list(); break;
+        case CorpusKind::Quotes: quote(); break;
+        case CorpusKind::Tables: table(200, 800); break;
+        case CorpusKind::Fences: fence(200, 2000); break;
+        case CorpusKind::LongLines: longLine(); break;
+        case CorpusKind::Mixed:
+            switch (rng.next() % 10) {
+            case 0: heading(); break;
+            case 1: list(); break;
+            case 2: quote(); break;
+            case 3: table(2, 40); break;
+            case 4: fence(3, 60); break;
+            case 5: rule(); break;
+            case 6: paragraph(60); break;
+            default: paragraph(10); break;
+            }
+            break;
+        }
+    }
+
+private:
+    std::string& out;
+    Rng rng;
+};
+
+} // namespace
+
+const char* corpusName(CorpusKind kind) {
+    switch (kind) {
+    case CorpusKind::Paragraphs: return "paragraphs";
+    case CorpusKind::Inline: return "inline";
+    case CorpusKind::Headings: return "headings";
+    case CorpusKind::Lists: return "lists";
+    case CorpusKind::Quotes: return "quotes";
+    case CorpusKind::Tables: return "tables";
+    case CorpusKind::Fences: return "fences";
+    case CorpusKind::Mixed: return "mixed";
+    case CorpusKind::LongLines: return "longlines";
+    }
+    return "";
+}
+
+bool parseCorpusKind(std::string_view name, CorpusKind& kind) {
+    for (CorpusKind k : AllCorpusKinds) {
+        if (name == corpusName(k)) {
+            kind = k;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Unmatched and half-matched delimiters of every inline construct, block
+// markers that invite rescanning, and text that stresses wrapping
+const AdversarialInput AdversarialInputs[] = {
+    { "stars", "*" },
+    { "star-pairs", "** " },
+    { "star-words", "*a **b " },
+    { "underscores", "_" },
+    { "underscore-pairs", "__a " },
+    { "brackets", "[" },
+    { "close-brackets", "]" },
+    { "link-opens", "[a](" },
+    { "links-no-url", "[a] " },
+    { "image-opens", "![a](" },
+    { "bangs", "![" },
+    { "backticks", "`" },
+    { "backtick-words", "`a " },
+    { "mixed-markers", "*_[`!(" },
+    { "nested-opens", "**__[![`*_" },
+    { "nested-closes", "`_*])]__**" },
+    { "backslashes", "\\" },
+    { "pipes", "|" },
+    { "escaped-pipes", "\\|" },
+    { "wide-row", "| a " },
+    { "quote-markers", ">" },
+    { "hashes", "#" },
+    { "tildes", "~" },
+    { "spaces", " " },
+    { "long-word", "a" },
+    { "escapes", "\x1b[" },
+    { "sgr-params", "\x1b[1;" },
+    { "combining", "\xcc\x81" },
+    { "wide-chars", "\xe6\x97\xa5" },
+    { "invalid-utf8", "\xff" },
+    { "blank-lines", "\n" },
+    { "paragraph-lines", "*a\n" },
+    { "table-rows", "| *a | [b |\n" },
+    { "list-lines", "- _a\n" },
+    { "quote-lines", "> [a](\n" },
+    { "fence-lines", "```\n*a\n" },
+};
+const size_t AdversarialInputCount = sizeof(AdversarialInputs) / sizeof(AdversarialInputs[0]);
+
+std::string generateAdversarial(const AdversarialInput& input, size_t bytes) {
+    std::string out;
+    out.reserve(bytes + input.unit.size() + 1);
+    while (out.size() < bytes)
+        out += input.unit;
+    if (out.back() != '\n') out += '\n';
+    return out;
+}
+
+std::string generateCorpus(CorpusKind kind, size_t bytes, uint64_t seed) {
+    std::string out;
+    out.reserve(bytes + bytes / 8);
+    // Each kind gets its own stream so corpora do not share their prefix
+    Generator gen(out, seed * 31 + static_cast<uint64_t>(kind));
+    while (out.size() < bytes)
+        gen.block(kind);
+    return out;
+}
+
+} // namespace mdmni
@@ -0,0 +1,54 @@
+#ifndef CORPUS_H
+#define CORPUS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace mdmni {
+
+// Synthetic documents for benchmarking. Every kind stresses one part of the
+// renderer; Mixed interleaves all of them. Generation is deterministic for a
+// given kind, size and seed on every platform.
+enum class CorpusKind {
+    Paragraphs,  // plain prose, few inline constructs
+    Inline,      // links, images, emphasis and code spans in every sentence
+    Headings,
+    Lists,
+    Quotes,
+    Tables,      // wide tables with hundreds of rows
+    Fences,      // long code fences
+    Mixed,       // all of the above, deeply interleaved
+    LongLines,   // multi-MB single lines
+};
+
+constexpr CorpusKind AllCorpusKinds[] = {
+    CorpusKind::Paragraphs, CorpusKind::Inline, CorpusKind::Headings,
+    CorpusKind::Lists, CorpusKind::Quotes, CorpusKind::Tables,
+    CorpusKind::Fences, CorpusKind::Mixed, CorpusKind::LongLines,
+};
+
+const char* corpusName(CorpusKind kind);
+// Returns false if name is not a known corpus
+bool parseCorpusKind(std::string_view name, CorpusKind& kind);
+
+// A document of kind of roughly bytes size (never less)
+std::string generateCorpus(CorpusKind kind, size_t bytes, uint64_t seed = 1);
+
+// Pathological input for the linear-time check: unit repeated to the
+// requested size, so it is one long line unless unit holds a newline
+struct AdversarialInput {
+    const char* name;
+    std::string_view unit;
+};
+
+extern const AdversarialInput AdversarialInputs[];
+extern const size_t AdversarialInputCount;
+
+// unit repeated until the document has at least bytes bytes
+std::string generateAdversarial(const AdversarialInput& input, size_t bytes);
+
+} // namespace mdmni
+
+#endif // CORPUS_H
@@ -0,0 +1,403 @@
+#include "AnsiWriter.h"
+#include "TextWidth.h"
+#include "TextWrap.h"
+#include <algorithm>
+
+namespace mdmni {
+
+// Block buffers keep their capacity so the next block reuses it without
+// allocating. After an unusually large block they are freed instead, so one
+// huge table or paragraph does not pin its memory for the rest of the run.
+constexpr size_t RetainedBlockBytes = 1 << 20;
+
+template<typename Buffer>
+static void releaseIfLarge(Buffer& b) {
+    if (b.capacity() * sizeof(b[0]) > RetainedBlockBytes) Buffer().swap(b);
+}
+
+AnsiWriterBase::AnsiWriterBase(const RenderOptions& opts)
+    : colored(opts.useColor), wrap(opts.wrap), inlineOut(&inlineBuffer), tableRowLimit(opts.tableRowLimit) {
+    buildSpans();
+}
+
+void AnsiWriterBase::setTheme(const Theme& t) {
+    theme = t;
+    buildSpans();
+}
+
+void AnsiWriterBase::setStats(RenderStats* s) {
+    stats = StatsCompiled ? s : nullptr;
+    sink.setStats(stats);
+}
+
+void AnsiWriterBase::reset() {
+    clearTable();
+    inlineOut = &inlineBuffer;
+    sink.discard();
+}
+
+void AnsiWriterBase::buildSpans() {
+    auto set = [&](InlineSpan span, const std::string& style, std::string_view open, std::string_view close) {
+        std::string& o = spanOpen[static_cast<size_t>(span)];
+        std::string& c = spanClose[static_cast<size_t>(span)];
+        o.clear();
+        c.clear();
+        if (colored) o = style;
+        o += open;
+        c += close;
+        if (colored) c += theme.reset;
+    };
+    set(InlineSpan::Code, theme.code, "", "");
+    set(InlineSpan::Bold, theme.bold, "", "");
+    set(InlineSpan::Italic, theme.italic, "", "");
+    set(InlineSpan::Link, theme.link, "", "");
+    set(InlineSpan::Image, theme.image, "[Image: ", "]");
+    urlOpen = " ";
+    if (colored) urlOpen += theme.url;
+    urlOpen += '<';
+    urlClose = ">";
+    if (colored) urlClose += theme.reset;
+}
+
+template<bool Color, bool Urls>
+void AnsiWriter<Color, Urls>::beginBlock(const Block& b) {
+    switch (b.kind) {
+    case BlockKind::Heading:
+        sink.newline();
+        [[fallthrough]];
+    case BlockKind::Paragraph:
+    case BlockKind::ListItem:
+        inlineBuffer.clear();
+        inlineOut = &inlineBuffer;
+        return;
+    case BlockKind::Quote:
+        inlineBuffer.clear();
+        if constexpr (Color) inlineBuffer += theme.quoteText;
+        inlineOut = &inlineBuffer;
+        return;
+    case BlockKind::CodeBlock:
+        sink.newline();
+        return;
+    case BlockKind::Table:
+        return;
+    case BlockKind::TableRow:
+        tableRows.push_back(TableRow{tableCells.size(), 0, b.separator});
+        tableColumn = 0;
+        return;
+    case BlockKind::TableCell:
+        beginTableCell();
+        return;
+    }
+}
+
+template<bool Color, bool Urls>
+void AnsiWriter<Color, Urls>::endBlock(const Block& b) {
+    switch (b.kind) {
+    case BlockKind::Paragraph:
+        // One line, or wrapped to the wrap width
+        appendWrapped(inlineBuffer, 0, "", 0);
+        sink.newline();
+        releaseIfLarge(inlineBuffer);
+        releaseIfLarge(wrapBuffer);
+        return;
+    case BlockKind::Heading:
+        if constexpr (Color) {
+            sink << theme.heading[std::min(std::max(b.level, 1), 6) - 1] << inlineBuffer << theme.reset;
+        } else {
+            sink.repeat("#", static_cast<size_t>(b.level));
+            sink << " " << inlineBuffer;
+        }
+        sink.newline();
+        return;
+    case BlockKind::Quote: {
+        std::string& bar = prefixBuffer;
+        bar.clear();
+        if constexpr (Color) {
+            inlineBuffer += theme.reset;
+            bar.append(theme.quoteBar).append("│ ").append(theme.reset);
+        } else {
+            bar = "| ";
+        }
+        sink << bar;
+        appendWrapped(inlineBuffer, 2, bar, 2);
+        sink.newline();
+        return;
+    }
+    case BlockKind::ListItem: {
+        std::string_view sym = b.marker.size() == 1 ? std::string_view("•") : b.marker;
+        if constexpr (Color) sink << theme.listBullet << sym << theme.reset << " ";
+        else sink << sym << " ";
+        // Continuation lines hang under the item text
+        size_t indent = displayWidth(sym) + 1;
+        prefixBuffer.assign(indent, ' ');
+        appendWrapped(inlineBuffer, indent, prefixBuffer, indent);
+        sink.newline();
+        return;
+    }
+    case BlockKind::CodeBlock:
+        // An unterminated fence just ends with the document
+        if (b.closed) sink.newline();
+        return;
+    case BlockKind::Table:
+        endTable<Color>();
+        return;
+    case BlockKind::TableRow:
+        endTableRow<Color>();
+        return;
+    case BlockKind::TableCell:
+        endTableCell();
+        return;
+    }
+}
+
+template<bool Color, bool Urls>
+void AnsiWriter<Color, Urls>::codeLine(std::string_view line) {
+    if constexpr (Color) sink << theme.codeBlock << "  " << line << theme.reset;
+    else sink << "    " << line;
+    sink.newline();
+}
+
+void AnsiWriterBase::rule() {
+    int width = wrap > 0 ? wrap : 80;
+    int w = std::max(10, std::min(1000, width - 2));
+    sink.repeat("─", static_cast<size_t>(w));
+    sink.newline();
+}
+
+// Write styled text that starts at column, wrapped to the wrap width when set
+void AnsiWriterBase::appendWrapped(std::string_view text, size_t column, std::string_view indent, size_t indentColumns) {
+    if (wrap <= 0) {
+        sink << text;
+        return;
+    }
+    PhaseScope phase(stats, Phase::Inline);
+    wrapBuffer.clear();
+    wrapText(text, static_cast<size_t>(wrap), column, indent, indentColumns, wrapBuffer);
+    sink << wrapBuffer;
+}
+
+// Cells are styled straight into tableText and measured once they end.
+// Separator rows only add columns; once rows stream, the borders are out
+// and cells beyond the fixed columns are dropped.
+void AnsiWriterBase::beginTableCell() {
+    size_t j = tableColumn++;
+    tableCellSkipped = tableRows.back().separator;
+    if (j >= tableWidths.size()) {
+        if (tableStreaming) tableCellSkipped = true;
+        else tableWidths.push_back(1);
+    }
+    if (tableCellSkipped) {
+        inlineBuffer.clear();
+        inlineOut = &inlineBuffer;
+        return;
+    }
+    tableCellStart = tableText.size();
+    inlineOut = &tableText;
+}
+
+void AnsiWriterBase::endTableCell() {
+    if (tableCellSkipped) return;
+    size_t j = tableColumn - 1;
+    size_t width = displayWidth(std::string_view(tableText).substr(tableCellStart));
+    tableCells.push_back({tableCellStart, tableText.size() - tableCellStart, width});
+    ++tableRows.back().cellCount;
+    if (!tableStreaming) tableWidths[j] = std::max(tableWidths[j], width);
+}
+
+template<bool Color>
+void AnsiWriterBase::endTableRow() {
+    if (tableRows.back().separator) tableHasSeparator = true;
+    if (tableStreaming) {
+        printTableRows<Color>();
+    } else if (tableRowLimit && tableRows.size() >= tableRowLimit && !tableWidths.empty()) {
+        // Fix the column widths from what we have and stream from here on
+        fitTableWidths();
+        printTableBorder("┌", "┬", "┐");
+        printTableRows<Color>();
+        tableStreaming = true;
+    }
+}
+
+void AnsiWriterBase::printTableBorder(const char* left, const char* mid, const char* right) {
+    sink << left;
+    for (size_t j = 0; j < tableWidths.size(); ++j) {
+        sink.repeat("─", tableWidths[j] + 2);
+        sink << (j + 1 < tableWidths.size() ? mid : right);
+    }
+    sink.newline();
+}
+
+// Narrow the widest columns until the table fits the wrap width. Cells
+// that no longer fit are wrapped onto extra lines when printed.
+void AnsiWriterBase::fitTableWidths() {
+    size_t numCols = tableWidths.size();
+    if (wrap <= 0 || numCols == 0) return;
+    // Every column adds "│ " and a space; the row ends with one more "│"
+    size_t frame = 3 * numCols + 1;
+    size_t avail = static_cast<size_t>(wrap) > frame + numCols ? wrap - frame : numCols;
+    size_t total = 0;
+    for (size_t w : tableWidths) total += w;
+    if (total <= avail) return;
+
+    // Largest cap on column width that makes the capped widths fit
+    std::vector<size_t>& sorted = tableSorted;
+    sorted.assign(tableWidths.begin(), tableWidths.end());
+    std::sort(sorted.begin(), sorted.end());
+    size_t left = avail;
+    size_t cols = numCols;
+    size_t cap = 1;
+    for (size_t w : sorted) {
+        if (w * cols > left) {
+            cap = std::max<size_t>(1, left / cols);
+            break;
+        }
+        left -= w;
+        --cols;
+    }
+    for (size_t& w : tableWidths) w = std::min(w, cap);
+}
+
+// Print and drop the rows held so far. A cell wider than its column is
+// wrapped onto extra lines with --wrap, and clipped with an ellipsis
+// otherwise (only possible once widths are fixed).
+template<bool Color>
+void AnsiWriterBase::printTableRows() {
+    if (stats) {
+        stats->peakTableBytes = std::max<uint64_t>(stats->peakTableBytes, tableText.size());
+        stats->peakTableRows = std::max<uint64_t>(stats->peakTableRows, tableRows.size());
+    }
+    size_t numCols = tableWidths.size();
+    // Grow only: shrinking would free the wrapped-cell strings' capacity
+    if (tableWrapped.size() < numCols) {
+        tableWrapped.resize(numCols);
+        tableWrapPos.resize(numCols);
+    }
+    for (const TableRow& row : tableRows) {
+        if (row.separator) {
+            printTableBorder("├", "┼", "┤");
+            tablePastSeparator = true;
+            continue;
+        }
+        bool isHeader = tableHasSeparator && !tablePastSeparator;
+
+        size_t lines = 1;
+        for (size_t j = 0; j < numCols; ++j) {
+            tableWrapPos[j] = std::string::npos;
+            if (wrap <= 0 || j >= row.cellCount) continue;
+            const TableCell& cell = tableCells[row.firstCell + j];
+            if (cell.width <= tableWidths[j]) continue;
+            tableWrapped[j].clear();
+            wrapText(std::string_view(tableText).substr(cell.offset, cell.length),
+                     tableWidths[j], 0, "", 0, tableWrapped[j]);
+            tableWrapPos[j] = 0;
+            lines = std::max(lines, 1 + static_cast<size_t>(
+                std::count(tableWrapped[j].begin(), tableWrapped[j].end(), '\n')));
+        }
+
+        for (size_t k = 0; k < lines; ++k) {
+            sink << "│";
+            for (size_t j = 0; j < numCols; ++j) {
+                std::string_view text;
+                size_t width = 0;
+                if (tableWrapPos[j] != std::string::npos) {
+                    // Next line of a wrapped cell
+                    const std::string& wrapped = tableWrapped[j];
+                    size_t begin = std::min(tableWrapPos[j], wrapped.size());
+                    size_t end = std::min(wrapped.find('\n', begin), wrapped.size());
+                    text = std::string_view(wrapped).substr(begin, end - begin);
+                    width = displayWidth(text);
+                    tableWrapPos[j] = end + 1;
+                } else if (k == 0 && j < row.cellCount) {
+                    const TableCell& cell = tableCells[row.firstCell + j];
+                    text = std::string_view(tableText).substr(cell.offset, cell.length);
+                    width = cell.width;
+                }
+                sink << " ";
+                if constexpr (Color) {
+                    if (isHeader) sink << theme.tableHeader;
+                }
+                if (width > tableWidths[j]) {
+                    appendClipped(text, tableWidths[j]);
+                    width = tableWidths[j];
+                } else {
+                    sink << text;
+                }
+                if constexpr (Color) {
+                    if (isHeader) sink << theme.reset;
+                }
+                sink.repeat(" ", tableWidths[j] - width);
+                sink << " │";
+            }
+            sink.newline();
+        }
+    }
+    tableRows.clear();
+    tableCells.clear();
+    tableText.clear();
+}
+
+// Write styled text clipped to columns, ending in "…"
+void AnsiWriterBase::appendClipped(std::string_view text, size_t columns) {
+    size_t n = 0;
+    size_t i = 0;
+    bool styled = false;
+    while (i < text.size()) {
+        if (size_t len = sgrLength(text, i)) {
+            styled = true;
+            i += len;
+            continue;
+        }
+        size_t len;
+        size_t w = static_cast<size_t>(charWidth(text, i, len));
+        if (n + w > columns - 1) break;
+        n += w;
+        i += len;
+    }
+    sink << text.substr(0, i) << "…";
+    if (styled) sink << theme.reset;
+    sink.repeat(" ", columns - 1 - n);
+}
+
+// Print the rest of the table with aligned column widths
+template<bool Color>
+void AnsiWriterBase::endTable() {
+    if (!tableStreaming && !tableWidths.empty()) {
+        fitTableWidths();
+        printTableBorder("┌", "┬", "┐");
+        printTableRows<Color>();
+    }
+    if (!tableWidths.empty()) printTableBorder("└", "┴", "┘");
+    clearTable();
+}
+
+// Drop the current table, keeping buffers for the next one unless it was huge
+void AnsiWriterBase::clearTable() {
+    tableRows.clear();
+    tableCells.clear();
+    tableText.clear();
+    tableWidths.clear();
+    releaseIfLarge(tableRows);
+    releaseIfLarge(tableCells);
+    releaseIfLarge(tableText);
+    releaseIfLarge(tableSorted);
+    for (std::string& wrapped : tableWrapped) releaseIfLarge(wrapped);
+    tableHasSeparator = false;
+    tablePastSeparator = false;
+    tableStreaming = false;
+}
+
+template class AnsiWriter<true, true>;
+template class AnsiWriter<true, false>;
+template class AnsiWriter<false, true>;
+template class AnsiWriter<false, false>;
+
+std::unique_ptr<AnsiWriterBase> makeAnsiWriter(const RenderOptions& opts) {
+    if (opts.useColor) {
+        if (opts.showUrls) return std::make_unique<AnsiWriter<true, true>>(opts);
+        return std::make_unique<AnsiWriter<true, false>>(opts);
+    }
+    if (opts.showUrls) return std::make_unique<AnsiWriter<false, true>>(opts);
+    return std::make_unique<AnsiWriter<false, false>>(opts);
+}
+
+} // namespace mdmni
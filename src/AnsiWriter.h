@@ -0,0 +1,125 @@
+#ifndef ANSI_WRITER_H
+#define ANSI_WRITER_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "DocumentEvents.h"
+#include "OutputSink.h"
+#include "RenderOptions.h"
+#include "RenderStats.h"
+#include "Theme.h"
+
+namespace mdmni {
+
+// Terminal output: the Renderer's styling, wrapping and table layout as a
+// DocumentHandler. Output goes to output(), which the owner attaches to a
+// stream or string first; endDocument() detaches it.
+//
+// This part does not depend on the color and URL options. AnsiWriter<Color,
+// Urls> below adds the block and span handlers, compiled for each
+// combination so per-line and per-block paths carry no option checks.
+class AnsiWriterBase : public DocumentHandler {
+public:
+    OutputSink& output() { return sink; }
+    // Escape sequences used when colors are on (default: Theme::standard())
+    void setTheme(const Theme& t);
+    // Count table sizes into s and charge writes to it; nullptr stops
+    void setStats(RenderStats* s);
+    // Drop any partial table and pending output, keeping allocated buffers
+    void reset();
+
+    void text(std::string_view s) override { inlineOut->append(s.data(), s.size()); }
+    void rule() override;
+    void blankLine() override { sink.newline(); }
+    void endDocument() override { sink.detach(); }
+
+protected:
+    explicit AnsiWriterBase(const RenderOptions& opts);
+
+    bool colored;  // only for building the span strings
+    int wrap;
+    Theme theme = Theme::standard();
+    OutputSink sink;
+    RenderStats* stats = nullptr;
+
+    // What each inline span adds around its content, chosen once from the
+    // theme and the color setting so spans cost one append on either side
+    std::string spanOpen[InlineSpanCount];
+    std::string spanClose[InlineSpanCount];
+    std::string urlOpen;
+    std::string urlClose;
+    std::string* inlineOut;  // where inline content of the current block goes
+
+    // Table rows are styled and measured as they arrive; the text of all
+    // cells lives in tableText
+    struct TableCell { size_t offset; size_t length; size_t width; };
+    struct TableRow { size_t firstCell; size_t cellCount; bool separator; };
+    size_t tableRowLimit = 0;
+    std::string tableText;
+    std::vector<TableCell> tableCells;
+    std::vector<TableRow> tableRows;
+    std::vector<size_t> tableWidths;
+    size_t tableColumn = 0;       // next cell of the row being read
+    size_t tableCellStart = 0;    // in tableText
+    bool tableCellSkipped = false;
+    bool tableHasSeparator = false;
+    bool tablePastSeparator = false;
+    bool tableStreaming = false;  // widths are fixed and rows go straight out
+    std::vector<std::string> tableWrapped;  // per column: lines of a wrapped cell
+    std::vector<size_t> tableWrapPos;       // next line in tableWrapped, or npos
+    std::vector<size_t> tableSorted;
+    // Scratch space reused from block to block
+    std::string inlineBuffer;
+    std::string prefixBuffer;
+    std::string wrapBuffer;
+
+    void buildSpans();
+    void appendWrapped(std::string_view text, size_t column, std::string_view indent, size_t indentColumns);
+    void beginTableCell();
+    void endTableCell();
+    template<bool Color> void endTableRow();
+    template<bool Color> void endTable();
+    void clearTable();
+    void printTableBorder(const char* left, const char* mid, const char* right);
+    void fitTableWidths();
+    template<bool Color> void printTableRows();
+    void appendClipped(std::string_view text, size_t columns);
+};
+
+// The writer for one setting of colors and URLs; makeAnsiWriter() picks it
+// from RenderOptions. Final, so a DocumentParser<AnsiWriter<...>> calls it
+// directly.
+template<bool Color, bool Urls>
+class AnsiWriter final : public AnsiWriterBase {
+public:
+    explicit AnsiWriter(const RenderOptions& opts) : AnsiWriterBase(opts) {}
+
+    void beginBlock(const Block& b) override;
+    void endBlock(const Block& b) override;
+    void beginSpan(InlineSpan kind, std::string_view) override {
+        const std::string& s = spanOpen[static_cast<size_t>(kind)];
+        if (!s.empty()) inlineOut->append(s);
+    }
+    void endSpan(InlineSpan kind, std::string_view url) override {
+        const std::string& s = spanClose[static_cast<size_t>(kind)];
+        if (!s.empty()) inlineOut->append(s);
+        if constexpr (Urls) {
+            if (kind >= InlineSpan::Link) inlineOut->append(urlOpen).append(url.data(), url.size()).append(urlClose);
+        }
+    }
+    void codeLine(std::string_view line) override;
+};
+
+extern template class AnsiWriter<true, true>;
+extern template class AnsiWriter<true, false>;
+extern template class AnsiWriter<false, true>;
+extern template class AnsiWriter<false, false>;
+
+// The AnsiWriter for opts.useColor and opts.showUrls
+std::unique_ptr<AnsiWriterBase> makeAnsiWriter(const RenderOptions& opts);
+
+} // namespace mdmni
+
+#endif // ANSI_WRITER_H
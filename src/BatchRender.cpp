@@ -0,0 +1,357 @@
+#include "BatchRender.h"
+#include "InputSource.h"
+#include "ParallelRender.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mdmni {
+
+namespace {
+
+// Files of at least two chunks are rendered by several workers
+constexpr size_t SplitChunkBytes = 512 * 1024;
+constexpr size_t NoChunk = static_cast<size_t>(-1);
+
+// Create every missing directory above path
+bool makeParents(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    if (slash == std::string::npos || slash == 0) return true;
+    std::string dir = path.substr(0, slash);
+    struct stat st;
+    if (stat(dir.c_str(), &st) == 0) {
+        if (S_ISDIR(st.st_mode)) return true;
+        errno = ENOTDIR;
+        return false;
+    }
+    if (!makeParents(dir)) return false;
+    return mkdir(dir.c_str(), 0777) == 0 || errno == EEXIST;
+}
+
+// Write parts[0, count) to a new file at path; false with errno set on failure.
+// writes counts the write(2) calls made.
+bool writeParts(const std::string& path, const std::string* parts, size_t count, uint64_t& writes) {
+    if (!makeParents(path)) return false;
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+    if (fd < 0) return false;
+    for (size_t i = 0; i < count; ++i) {
+        const char* p = parts[i].data();
+        size_t left = parts[i].size();
+        while (left > 0) {
+            ssize_t w = ::write(fd, p, left);
+            ++writes;
+            if (w < 0 && errno == EINTR) continue;
+            if (w <= 0) {
+                int saved = w < 0 ? errno : EIO;
+                ::close(fd);
+                errno = saved;
+                return false;
+            }
+            p += w;
+            left -= static_cast<size_t>(w);
+        }
+    }
+    return ::close(fd) == 0;
+}
+
+// A file rendered in pieces by several workers. The last piece to finish
+// writes the file.
+struct SplitFile {
+    std::unique_ptr<InputSource> in;  // keeps the mapping alive
+    size_t inputSize = 0;
+    std::vector<DocumentChunk> chunks;
+    std::vector<std::string> parts;
+    std::atomic<size_t> partsLeft{0};
+};
+
+struct Task {
+    size_t item;
+    size_t chunk;  // NoChunk: open the file, and render it unless it gets split
+};
+
+class Batch {
+public:
+    Batch(const std::vector<BatchItem>& items, const RenderOptions& opts, unsigned threads, std::ostream& errors,
+          RenderStats* stats)
+        : items(items), opts(opts), errors(errors), queues(threads), split(items.size()), stats(stats),
+          workerStats(stats ? threads : 0) {}
+
+    BatchSummary run();
+
+private:
+    // Each worker takes tasks from the back of its own deque and, once that is
+    // empty, steals from the front of the others'
+    struct Queue {
+        std::mutex m;
+        std::deque<Task> tasks;
+    };
+
+    const std::vector<BatchItem>& items;
+    RenderOptions opts;
+    std::ostream& errors;
+    std::vector<Queue> queues;
+    std::vector<std::unique_ptr<SplitFile>> split;
+    RenderStats* stats;
+    std::vector<RenderStats> workerStats;  // merged into stats at the end
+
+    std::atomic<size_t> queued{0};      // tasks waiting in some deque
+    std::atomic<size_t> unfinished{0};  // tasks queued or running
+    std::mutex idleMutex;
+    std::condition_variable idle;
+    std::mutex errorMutex;
+
+    std::atomic<size_t> rendered{0};
+    std::atomic<size_t> failed{0};
+    std::atomic<uint64_t> inputBytes{0};
+    std::atomic<uint64_t> outputBytes{0};
+
+    void push(size_t worker, Task t);
+    bool take(size_t worker, Task& t);
+    void work(size_t worker);
+    void openFile(size_t worker, size_t item, Renderer& r, std::string& out);
+    void renderChunk(size_t worker, size_t item, size_t chunk, Renderer& r);
+    void finishFile(size_t worker, size_t item, size_t inputSize, const std::string* parts, size_t count);
+    void fail(const std::string& path, int err);
+};
+
+BatchSummary Batch::run() {
+    auto start = std::chrono::steady_clock::now();
+    // Deal the files out round-robin; workers pop from the back, so queue
+    // them in reverse to start on each deque's first file
+    unfinished = items.size();
+    queued = items.size();
+    for (size_t i = items.size(); i-- > 0;)
+        queues[i % queues.size()].tasks.push_front(Task{i, NoChunk});
+
+    std::vector<std::thread> pool;
+    pool.reserve(queues.size() - 1);
+    for (size_t w = 1; w < queues.size(); ++w) pool.emplace_back([this, w] { work(w); });
+    work(0);
+    for (auto& t : pool) t.join();
+    for (const RenderStats& w : workerStats) stats->merge(w);
+
+    BatchSummary s;
+    s.rendered = rendered;
+    s.failed = failed;
+    s.inputBytes = inputBytes;
+    s.outputBytes = outputBytes;
+    s.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return s;
+}
+
+void Batch::push(size_t worker, Task t) {
+    // Counted before it can be stolen, so queued never drops below zero
+    ++queued;
+    {
+        std::lock_guard<std::mutex> lock(queues[worker].m);
+        queues[worker].tasks.push_back(t);
+    }
+    // Taking the lock orders this against an idle worker checking queued
+    { std::lock_guard<std::mutex> lock(idleMutex); }
+    idle.notify_one();
+}
+
+bool Batch::take(size_t worker, Task& t) {
+    {
+        Queue& own = queues[worker];
+        std::lock_guard<std::mutex> lock(own.m);
+        if (!own.tasks.empty()) {
+            t = own.tasks.back();
+            own.tasks.pop_back();
+            --queued;
+            return true;
+        }
+    }
+    for (size_t k = 1; k < queues.size(); ++k) {
+        Queue& victim = queues[(worker + k) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.m);
+        if (!victim.tasks.empty()) {
+            t = victim.tasks.front();
+            victim.tasks.pop_front();
+            --queued;
+            return true;
+        }
+    }
+    return false;
+}
+
+void Batch::work(size_t worker) {
+    // One renderer and output buffer per worker, reused from task to task
+    Renderer r(opts);
+    if (stats) r.setStats(&workerStats[worker]);
+    std::string out;
+    Task t;
+    for (;;) {
+        if (!take(worker, t)) {
+            std::unique_lock<std::mutex> lock(idleMutex);
+            idle.wait(lock, [&] { return queued > 0 || unfinished == 0; });
+            if (unfinished == 0) return;
+            continue;
+        }
+        if (t.chunk == NoChunk) openFile(worker, t.item, r, out);
+        else renderChunk(worker, t.item, t.chunk, r);
+        if (--unfinished == 0) {
+            std::lock_guard<std::mutex> lock(idleMutex);
+            idle.notify_all();
+        }
+    }
+}
+
+void Batch::openFile(size_t worker, size_t item, Renderer& r, std::string& out) {
+    const std::string& path = items[item].input;
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0) return fail(path, errno);
+    if (S_ISDIR(st.st_mode)) return fail(path, EISDIR);
+    auto in = InputSource::open(path);
+    if (!in) return fail(path, errno);
+
+    std::string storage;
+    std::string_view doc = in->remaining(storage);
+
+    // Only mapped files are split: their text stays put while the chunks
+    // are handed around
+    if (queues.size() > 1 && in->complete() && doc.size() >= 2 * SplitChunkBytes) {
+        auto f = std::make_unique<SplitFile>();
+        f->chunks = splitDocument(doc, SplitChunkBytes);
+        if (f->chunks.size() > 1) {
+            size_t n = f->chunks.size();
+            f->in = std::move(in);
+            f->inputSize = doc.size();
+            f->parts.resize(n);
+            f->partsLeft = n;
+            split[item] = std::move(f);
+            unfinished += n;
+            for (size_t c = n; c-- > 0;) push(worker, Task{item, c});
+            return;
+        }
+    }
+
+    out.clear();
+    r.render(doc, out);
+    finishFile(worker, item, doc.size(), &out, 1);
+}
+
+void Batch::renderChunk(size_t worker, size_t item, size_t chunk, Renderer& r) {
+    SplitFile& f = *split[item];
+    r.restoreFence(f.chunks[chunk].fence);
+    r.render(f.chunks[chunk].text, f.parts[chunk]);
+    if (--f.partsLeft == 0) {
+        finishFile(worker, item, f.inputSize, f.parts.data(), f.parts.size());
+        split[item].reset();
+    }
+}
+
+void Batch::finishFile(size_t worker, size_t item, size_t inputSize, const std::string* parts, size_t count) {
+    const std::string& path = items[item].output;
+    auto start = std::chrono::steady_clock::now();
+    uint64_t writes = 0;
+    bool written = writeParts(path, parts, count, writes);
+    if (stats) {
+        RenderStats& s = workerStats[worker];
+        s.phaseNanos[static_cast<size_t>(Phase::Write)] += static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count());
+        s.outputWrites += writes;
+    }
+    if (!written) return fail(path, errno);
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < count; ++i) bytes += parts[i].size();
+    inputBytes += inputSize;
+    outputBytes += bytes;
+    ++rendered;
+}
+
+void Batch::fail(const std::string& path, int err) {
+    ++failed;
+    std::lock_guard<std::mutex> lock(errorMutex);
+    errors << "mdmni: " << path << ": " << std::strerror(err) << '\n';
+}
+
+// Lexically normalize path: empty and "." components go, and ".." removes
+// the component before it. With confine, the result is relative and a ".."
+// with nothing left to remove is dropped, so the path cannot climb out of
+// whatever directory it is later placed in.
+std::string normalizePath(const std::string& path, bool confine) {
+    bool absolute = !confine && !path.empty() && path[0] == '/';
+    std::vector<std::string_view> parts;
+    size_t climbs = 0;  // leading ".." kept when not confined
+    std::string_view rest(path);
+    while (!rest.empty()) {
+        size_t slash = rest.find('/');
+        std::string_view part = rest.substr(0, slash);
+        rest = slash == std::string_view::npos ? std::string_view() : rest.substr(slash + 1);
+        if (part.empty() || part == ".") continue;
+        if (part != "..") parts.push_back(part);
+        else if (!parts.empty()) parts.pop_back();
+        else if (!confine && !absolute) ++climbs;
+    }
+    std::string result = absolute ? "/" : "";
+    for (size_t i = 0; i < climbs; ++i) result += "../";
+    for (std::string_view part : parts) {
+        result.append(part.data(), part.size());
+        result += '/';
+    }
+    if (result.size() > 1 && result.back() == '/') result.pop_back();
+    return result;
+}
+
+} // namespace
+
+std::string batchOutputPath(const std::string& input, const std::string& dir, const std::string& suffix) {
+    std::string path = dir.empty() ? input : normalizePath(input, true);
+    size_t slash = path.find_last_of('/');
+    size_t dot = path.find_last_of('.');
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+        std::string_view ext = std::string_view(path).substr(dot);
+        if (ext == ".md" || ext == ".markdown") path.erase(dot);
+    }
+    path += suffix;
+    if (dir.empty()) return path;
+    return dir.back() == '/' ? dir + path : dir + "/" + path;
+}
+
+BatchSummary renderBatch(const std::vector<BatchItem>& items, const RenderOptions& opts,
+                         unsigned jobs, std::ostream& errors, RenderStats* stats) {
+    if (items.empty()) return BatchSummary();
+
+    // Two items writing one file would race on it, and an output that is
+    // also an input would be truncated while it is read; such items are
+    // reported and left out before any worker starts
+    std::unordered_map<std::string, size_t> claimed;  // normalized path -> item
+    for (size_t i = 0; i < items.size(); ++i) claimed.emplace(normalizePath(items[i].input, false), i);
+    std::vector<BatchItem> unique;
+    unique.reserve(items.size());
+    size_t collisions = 0;
+    for (size_t i = 0; i < items.size(); ++i) {
+        auto [at, fresh] = claimed.emplace(normalizePath(items[i].output, false), i);
+        if (!fresh) {
+            errors << "mdmni: " << items[i].input << ": output " << items[i].output << " is also "
+                   << (normalizePath(items[at->second].input, false) == at->first ? "the input " : "the output for ")
+                   << items[at->second].input << '\n';
+            ++collisions;
+            continue;
+        }
+        unique.push_back(items[i]);
+    }
+
+    unsigned threads = std::max(1u, jobs);
+    BatchSummary s;
+    if (!unique.empty()) {
+        Batch batch(unique, opts, threads, errors, stats);
+        s = batch.run();
+    }
+    s.failed += collisions;
+    return s;
+}
+
+} // namespace mdmni
@@ -0,0 +1,46 @@
+#ifndef BATCH_RENDER_H
+#define BATCH_RENDER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Renderer.h"
+
+namespace mdmni {
+
+// One input file and the file its rendering is written to
+struct BatchItem {
+    std::string input;
+    std::string output;
+};
+
+struct BatchSummary {
+    size_t rendered = 0;
+    size_t failed = 0;
+    uint64_t inputBytes = 0;
+    uint64_t outputBytes = 0;
+    double seconds = 0;
+};
+
+// Where the rendering of input goes: the input path with a trailing .md or
+// .markdown replaced by suffix, placed under dir when it is not empty.
+// With a dir, the input path is normalized first and any ".." that would
+// climb above its start, like a leading "/", is dropped, so everything stays
+// inside dir.
+std::string batchOutputPath(const std::string& input, const std::string& dir, const std::string& suffix);
+
+// Render every item on a work-stealing pool of jobs threads, each with its
+// own Renderer. Files larger than a few chunks are split at BlockIndex
+// checkpoints so one huge file does not leave the other workers idle.
+// A file that cannot be read or written is reported on errors as
+// "mdmni: path: reason" and the rest of the batch carries on. Statistics of
+// all workers are added to stats when given. Items whose output is another
+// item's output or input are reported and counted as failed, not rendered.
+BatchSummary renderBatch(const std::vector<BatchItem>& items, const RenderOptions& opts,
+                         unsigned jobs, std::ostream& errors, RenderStats* stats = nullptr);
+
+} // namespace mdmni
+
+#endif // BATCH_RENDER_H
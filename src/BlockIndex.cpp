@@ -0,0 +1,185 @@
+#include "BlockIndex.h"
+#include <algorithm>
+#include <cstring>
+
+namespace mdmni {
+
+BlockIndex::BlockIndex(std::string_view doc_, size_t segmentBytes_)
+    : doc(doc_), segmentBytes(segmentBytes_ ? segmentBytes_ : DefaultSegmentBytes) {
+    checkpoints.push_back(Checkpoint{0, FenceState()});
+}
+
+void BlockIndex::scanLine() {
+    size_t start = scanPos;
+    const char* nl = static_cast<const char*>(std::memchr(doc.data() + start, '\n', doc.size() - start));
+    size_t lineEnd = nl ? static_cast<size_t>(nl - doc.data()) : doc.size();
+    std::string_view line = doc.substr(start, lineEnd - start);
+    if (!line.empty() && line.back() == '\r') line.remove_suffix(1);
+    scanPos = nl ? lineEnd + 1 : doc.size();
+
+    FenceState before = fence;
+    LineInfo info = fence.advance(line);
+    size_t last = checkpoints.back().offset;
+    if (info.kind == LineKind::Heading) {
+        if (start > last) checkpoints.push_back(Checkpoint{start, before});
+        headingMarks.push_back(HeadingMark{start, info.level, info.text});
+    } else if (clean && start - last >= segmentBytes) {
+        checkpoints.push_back(Checkpoint{start, before});
+    }
+
+    // Only lines outside fences change what the renderer has buffered
+    if (!before.inside) {
+        if (info.kind == LineKind::Blank || info.kind == LineKind::Heading) clean = true;
+        else if (info.kind != LineKind::FenceOpen) clean = false;
+    }
+}
+
+void BlockIndex::extendTo(size_t count) {
+    while (checkpoints.size() < count && !complete()) scanLine();
+}
+
+void BlockIndex::extendAll() {
+    while (!complete()) scanLine();
+}
+
+bool BlockIndex::ensureSegment(size_t i) {
+    extendTo(i + 2);
+    return i < segmentsKnown();
+}
+
+std::string_view BlockIndex::segment(size_t i) const {
+    size_t begin = checkpoints[i].offset;
+    size_t end = i + 1 < checkpoints.size() ? checkpoints[i + 1].offset : doc.size();
+    return doc.substr(begin, end - begin);
+}
+
+namespace {
+
+size_t commonPrefix(std::string_view a, std::string_view b) {
+    size_t n = std::min(a.size(), b.size());
+    size_t i = 0;
+    // Whole blocks with memcmp first, then the differing block byte by byte
+    constexpr size_t Block = 4096;
+    while (i + Block <= n && std::memcmp(a.data() + i, b.data() + i, Block) == 0) i += Block;
+    while (i < n && a[i] == b[i]) ++i;
+    return i;
+}
+
+size_t commonSuffix(std::string_view a, std::string_view b, size_t limit) {
+    size_t n = std::min({a.size(), b.size(), limit});
+    size_t i = 0;
+    constexpr size_t Block = 4096;
+    while (i + Block <= n &&
+           std::memcmp(a.data() + a.size() - i - Block, b.data() + b.size() - i - Block, Block) == 0)
+        i += Block;
+    while (i < n && a[a.size() - 1 - i] == b[b.size() - 1 - i]) ++i;
+    return i;
+}
+
+} // namespace
+
+IndexEdit BlockIndex::update(std::string_view newDoc) {
+    std::string_view oldDoc = doc;
+    size_t prefix = commonPrefix(oldDoc, newDoc);
+    size_t suffix = commonSuffix(oldDoc, newDoc, std::min(oldDoc.size(), newDoc.size()) - prefix);
+    size_t newEnd = newDoc.size() - suffix;  // changed bytes end here in newDoc
+    auto toNew = [&](size_t oldOffset) { return oldOffset - oldDoc.size() + newDoc.size(); };
+
+    // Heading texts point into the document
+    auto rebase = [&](HeadingMark& h, size_t offset) {
+        h.text = newDoc.substr(h.text.data() - oldDoc.data() - h.offset + offset, h.text.size());
+        h.offset = offset;
+    };
+
+    IndexEdit edit;
+    doc = newDoc;
+    if (prefix == oldDoc.size() && prefix == newDoc.size()) {
+        for (HeadingMark& h : headingMarks) rebase(h, h.offset);
+        edit.first = segmentsKnown();
+        return edit;
+    }
+
+    // Decisions for lines before the one holding the first change are the
+    // same as before, so the last checkpoint ahead of that line stands. The
+    // scan restarts there: its line is unchanged, so it is either a heading
+    // (after which the scanner is clean) or a checkpoint placed while clean.
+    size_t lineStart = prefix;
+    while (lineStart > 0 && oldDoc[lineStart - 1] != '\n') --lineStart;
+    auto firstAfter = std::lower_bound(checkpoints.begin() + 1, checkpoints.end(), lineStart,
+                                       [](const Checkpoint& c, size_t off) { return c.offset < off; });
+    size_t first = static_cast<size_t>(firstAfter - checkpoints.begin()) - 1;
+    size_t oldSegments = segmentsKnown();
+    edit.first = first;
+
+    if (scanPos <= lineStart && !complete()) {
+        // Nothing from the changed part has been scanned yet
+        for (HeadingMark& h : headingMarks) rebase(h, h.offset);
+        edit.removed = edit.inserted = 0;
+        edit.first = oldSegments;
+        return edit;
+    }
+
+    std::vector<Checkpoint> oldTail(checkpoints.begin() + first + 1, checkpoints.end());
+    size_t restart = checkpoints[first].offset;
+    auto headsAfter = std::lower_bound(headingMarks.begin(), headingMarks.end(), restart,
+                                       [](const HeadingMark& h, size_t off) { return h.offset < off; });
+    std::vector<HeadingMark> oldHeads(headsAfter, headingMarks.end());
+    headingMarks.erase(headsAfter, headingMarks.end());
+    for (HeadingMark& h : headingMarks) rebase(h, h.offset);
+    bool oldComplete = scanPos >= oldDoc.size();
+    size_t oldScanPos = scanPos;
+    FenceState oldFence = fence;
+    bool oldClean = clean;
+
+    checkpoints.resize(first + 1);
+    scanPos = restart;
+    fence = checkpoints[first].fence;
+    clean = true;
+
+    while (!complete()) {
+        size_t before = checkpoints.size();
+        scanLine();
+        if (checkpoints.size() == before) continue;
+        const Checkpoint& c = checkpoints.back();
+        if (c.offset < newEnd) continue;
+        // Past the old scan: carry on lazily from here
+        size_t oldOffset = c.offset - newDoc.size() + oldDoc.size();
+        if (oldOffset >= oldScanPos) break;
+        auto match = std::lower_bound(oldTail.begin(), oldTail.end(), oldOffset,
+                                      [](const Checkpoint& o, size_t off) { return o.offset < off; });
+        if (match == oldTail.end() || match->offset != oldOffset || !(match->fence == c.fence)) continue;
+
+        // In step with the old scan again: take over everything it found
+        size_t matched = static_cast<size_t>(match - oldTail.begin()) + first + 1;
+        edit.removed = matched - first;
+        edit.inserted = checkpoints.size() - 1 - first;
+        for (auto it = match + 1; it != oldTail.end(); ++it)
+            checkpoints.push_back(Checkpoint{toNew(it->offset), it->fence});
+        for (HeadingMark& h : oldHeads) {
+            if (h.offset <= oldOffset) continue;
+            headingMarks.push_back(h);
+            rebase(headingMarks.back(), toNew(h.offset));
+        }
+        if (oldComplete) {
+            scanPos = newDoc.size();
+        } else {
+            scanPos = toNew(oldScanPos);
+            fence = oldFence;
+            clean = oldClean;
+        }
+        return edit;
+    }
+
+    edit.removed = oldSegments - first;
+    edit.inserted = segmentsKnown() - first;
+    return edit;
+}
+
+size_t BlockIndex::segmentAt(size_t offset) {
+    while (!complete() && checkpoints.back().offset <= offset) scanLine();
+    auto it = std::upper_bound(checkpoints.begin(), checkpoints.end(), offset,
+                               [](size_t off, const Checkpoint& c) { return off < c.offset; });
+    return static_cast<size_t>(it - checkpoints.begin()) - 1;
+}
+
+} // namespace mdmni
@@ -0,0 +1,93 @@
+#ifndef BLOCK_INDEX_H
+#define BLOCK_INDEX_H
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+#include "LineClassifier.h"
+
+namespace mdmni {
+
+// A line at which rendering can resume: a fresh Renderer given this fence
+// state continues exactly as one that had processed everything before it.
+struct Checkpoint {
+    size_t offset;
+    FenceState fence;
+};
+
+// Segments [first, first + removed) of the old document were replaced by
+// segments [first, first + inserted) of the new one; later segments are
+// unchanged apart from their offsets
+struct IndexEdit {
+    size_t first = 0;
+    size_t removed = 0;
+    size_t inserted = 0;
+};
+
+struct HeadingMark {
+    size_t offset;
+    int level;
+    std::string_view text;  // raw heading text, inline markup included
+};
+
+// Incremental index of resumable positions in an in-memory document.
+//
+// A checkpoint is placed wherever the renderer holds no buffered paragraph
+// or table: after blank lines and headings outside fences, inside fences
+// opened at such a point, and before every heading (a heading flushes
+// anything pending before it prints). Apart from headings, checkpoints are
+// spaced at least segmentBytes apart. Segment i is the text between
+// checkpoints i and i + 1.
+//
+// Scanning is lazy, so opening a huge document only pays for the part that
+// is actually looked at.
+class BlockIndex {
+public:
+    static constexpr size_t DefaultSegmentBytes = 16 * 1024;
+
+    explicit BlockIndex(std::string_view doc, size_t segmentBytes = DefaultSegmentBytes);
+
+    // Scan until at least count checkpoints exist or the document is fully indexed
+    void extendTo(size_t count);
+    void extendAll();
+    bool complete() const { return scanPos >= doc.size(); }
+
+    // Make segment i available; false if the document has fewer segments
+    bool ensureSegment(size_t i);
+    // Number of segments; only final once complete()
+    size_t segmentsKnown() const { return complete() ? checkpoints.size() : checkpoints.size() - 1; }
+
+    const Checkpoint& checkpoint(size_t i) const { return checkpoints[i]; }
+    // Source text of segment i, which must have been made available
+    std::string_view segment(size_t i) const;
+    // Segment containing byte offset, scanning as far as needed
+    size_t segmentAt(size_t offset);
+
+    // Headings outside fences found so far, in document order
+    const std::vector<HeadingMark>& headings() const { return headingMarks; }
+
+    std::string_view document() const { return doc; }
+
+    // Switch to an edited version of the document. Only the lines from the
+    // first difference are scanned again, until a checkpoint with the same
+    // fence state as the old one at the matching place in the unchanged
+    // tail; from there the old checkpoints are reused, shifted. The old
+    // document must stay valid during the call.
+    IndexEdit update(std::string_view newDoc);
+
+private:
+    std::string_view doc;
+    size_t segmentBytes;
+    std::vector<Checkpoint> checkpoints;
+    std::vector<HeadingMark> headingMarks;
+
+    size_t scanPos = 0;
+    FenceState fence;
+    bool clean = true;  // renderer holds no buffered paragraph or table at scanPos
+
+    void scanLine();
+};
+
+} // namespace mdmni
+
+#endif // BLOCK_INDEX_H
@@ -0,0 +1,226 @@
+#include "ByteScan.h"
+#include <cstdlib>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define MDMNI_SCAN_X86 1
+#include <immintrin.h>
+#endif
+
+namespace mdmni {
+
+namespace {
+
+//
+// Scalar
+//
+
+template<char... Cs>
+size_t findAnyScalar(const char* p, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        char c = p[i];
+        if (((c == Cs) || ...)) return i;
+    }
+    return n;
+}
+
+size_t outsideRangeScalar(const char* p, size_t n, unsigned char lo, unsigned char hi) {
+    unsigned char span = static_cast<unsigned char>(hi - lo);
+    for (size_t i = 0; i < n; ++i)
+        if (static_cast<unsigned char>(static_cast<unsigned char>(p[i]) - lo) > span) return i;
+    return n;
+}
+
+#ifdef MDMNI_SCAN_X86
+
+//
+// SSE2, 16 bytes at a time
+//
+
+template<char... Cs>
+__attribute__((target("sse2")))
+size_t findAnySse2(const char* p, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        __m128i hit = _mm_setzero_si128();
+        ((hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, _mm_set1_epi8(Cs)))), ...);
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hit));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return i + findAnyScalar<Cs...>(p + i, n - i);
+}
+
+__attribute__((target("sse2")))
+size_t outsideRangeSse2(const char* p, size_t n, unsigned char lo, unsigned char hi) {
+    // x is in range when (x - lo) as unsigned is at most hi - lo
+    const __m128i base = _mm_set1_epi8(static_cast<char>(lo));
+    const __m128i span = _mm_set1_epi8(static_cast<char>(hi - lo));
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i d = _mm_sub_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)), base);
+        __m128i in = _mm_cmpeq_epi8(_mm_min_epu8(d, span), d);
+        unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(in)) & 0xFFFFu;
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    return i + outsideRangeScalar(p + i, n - i, lo, hi);
+}
+
+//
+// AVX2, 32 bytes at a time
+//
+
+template<char... Cs>
+__attribute__((target("avx2")))
+size_t findAnyAvx2(const char* p, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        __m256i hit = _mm256_setzero_si256();
+        ((hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, _mm256_set1_epi8(Cs)))), ...);
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    // The tail stays in VEX-encoded code: calling the SSE2 version with the
+    // upper register halves dirty costs a state transition on many CPUs
+    if (i + 16 <= n) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+        __m128i hit = _mm_setzero_si128();
+        ((hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, _mm_set1_epi8(Cs)))), ...);
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(hit));
+        if (mask) return i + __builtin_ctz(mask);
+        i += 16;
+    }
+    return i + findAnyScalar<Cs...>(p + i, n - i);
+}
+
+__attribute__((target("avx2")))
+size_t outsideRangeAvx2(const char* p, size_t n, unsigned char lo, unsigned char hi) {
+    const __m256i base = _mm256_set1_epi8(static_cast<char>(lo));
+    const __m256i span = _mm256_set1_epi8(static_cast<char>(hi - lo));
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i d = _mm256_sub_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i)), base);
+        __m256i in = _mm256_cmpeq_epi8(_mm256_min_epu8(d, span), d);
+        unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(in));
+        if (mask) return i + __builtin_ctz(mask);
+    }
+    if (i + 16 <= n) {
+        __m128i d = _mm_sub_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i)),
+                                 _mm256_castsi256_si128(base));
+        __m128i span128 = _mm256_castsi256_si128(span);
+        __m128i in = _mm_cmpeq_epi8(_mm_min_epu8(d, span128), d);
+        unsigned mask = ~static_cast<unsigned>(_mm_movemask_epi8(in)) & 0xFFFFu;
+        if (mask) return i + __builtin_ctz(mask);
+        i += 16;
+    }
+    return i + outsideRangeScalar(p + i, n - i, lo, hi);
+}
+
+#endif // MDMNI_SCAN_X86
+
+struct ScanFunctions {
+    ScanLevel level;
+    size_t (*inlineMarker)(const char*, size_t);
+    size_t (*tableMarker)(const char*, size_t);
+    size_t (*outsideRange)(const char*, size_t, unsigned char, unsigned char);
+};
+
+constexpr ScanFunctions ScalarScan = {
+    ScanLevel::Scalar,
+    findAnyScalar<'`', '!', '[', '*', '_'>,
+    findAnyScalar<'|', '\\'>,
+    outsideRangeScalar,
+};
+
+#ifdef MDMNI_SCAN_X86
+constexpr ScanFunctions Sse2Scan = {
+    ScanLevel::SSE2,
+    findAnySse2<'`', '!', '[', '*', '_'>,
+    findAnySse2<'|', '\\'>,
+    outsideRangeSse2,
+};
+
+constexpr ScanFunctions Avx2Scan = {
+    ScanLevel::AVX2,
+    findAnyAvx2<'`', '!', '[', '*', '_'>,
+    findAnyAvx2<'|', '\\'>,
+    outsideRangeAvx2,
+};
+#endif
+
+const ScanFunctions* functionsFor(ScanLevel level) {
+    switch (level) {
+    case ScanLevel::Scalar:
+        return &ScalarScan;
+#ifdef MDMNI_SCAN_X86
+    case ScanLevel::SSE2:
+        return &Sse2Scan;
+    case ScanLevel::AVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") ? &Avx2Scan : nullptr;
+#else
+    default:
+        break;
+#endif
+    }
+    return nullptr;
+}
+
+const ScanFunctions* selectAtStartup() {
+    ScanLevel cap = ScanLevel::AVX2;
+    if (const char* env = std::getenv("MDMNI_SIMD")) parseScanLevel(env, cap);
+    for (int l = static_cast<int>(cap); l >= 0; --l)
+        if (const ScanFunctions* f = functionsFor(static_cast<ScanLevel>(l))) return f;
+    return &ScalarScan;
+}
+
+// Scalar until dynamic initialization has run, so scanning from other static
+// initializers is safe too
+const ScanFunctions* active = &ScalarScan;
+[[maybe_unused]] const bool selected = (active = selectAtStartup()) != nullptr;
+
+} // namespace
+
+ScanLevel scanLevel() {
+    return active->level;
+}
+
+const char* scanLevelName(ScanLevel level) {
+    switch (level) {
+    case ScanLevel::Scalar: return "scalar";
+    case ScanLevel::SSE2: return "sse2";
+    case ScanLevel::AVX2: return "avx2";
+    }
+    return "";
+}
+
+bool parseScanLevel(std::string_view name, ScanLevel& level) {
+    for (ScanLevel l : { ScanLevel::Scalar, ScanLevel::SSE2, ScanLevel::AVX2 }) {
+        if (name == scanLevelName(l)) {
+            level = l;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool setScanLevel(ScanLevel level) {
+    const ScanFunctions* f = functionsFor(level);
+    if (!f) return false;
+    active = f;
+    return true;
+}
+
+size_t findInlineMarker(const char* p, size_t n) {
+    return active->inlineMarker(p, n);
+}
+
+size_t findTableMarker(const char* p, size_t n) {
+    return active->tableMarker(p, n);
+}
+
+size_t findOutsideRange(const char* p, size_t n, unsigned char lo, unsigned char hi) {
+    return active->outsideRange(p, n, lo, hi);
+}
+
+} // namespace mdmni
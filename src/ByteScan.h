@@ -0,0 +1,33 @@
+#ifndef BYTE_SCAN_H
+#define BYTE_SCAN_H
+
+#include <cstddef>
+#include <string_view>
+
+namespace mdmni {
+
+// Vectorized searches for the few bytes the renderer cares about, so plain
+// text is skipped 16 or 32 bytes at a time. The implementation is picked
+// once at startup: AVX2 when the CPU has it, SSE2 on any other x86-64, and
+// portable scalar code everywhere else. MDMNI_SIMD=scalar|sse2|avx2 in the
+// environment caps the choice.
+enum class ScanLevel { Scalar, SSE2, AVX2 };
+
+ScanLevel scanLevel();
+const char* scanLevelName(ScanLevel level);
+// Parse a name as printed by scanLevelName(); false if unknown
+bool parseScanLevel(std::string_view name, ScanLevel& level);
+// Switch implementations (for benchmarks); false if the CPU lacks support.
+// Not safe while other threads are scanning.
+bool setScanLevel(ScanLevel level);
+
+// Index of the first inline marker (` ! [ * _) in p[0, n), or n
+size_t findInlineMarker(const char* p, size_t n);
+// Index of the first '|' or '\' in p[0, n), or n
+size_t findTableMarker(const char* p, size_t n);
+// Index of the first byte outside [lo, hi] in p[0, n), or n
+size_t findOutsideRange(const char* p, size_t n, unsigned char lo, unsigned char hi);
+
+} // namespace mdmni
+
+#endif // BYTE_SCAN_H
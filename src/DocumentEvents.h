@@ -0,0 +1,100 @@
+#ifndef DOCUMENT_EVENTS_H
+#define DOCUMENT_EVENTS_H
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+namespace mdmni {
+
+enum class BlockKind {
+    Paragraph,
+    Heading,
+    Quote,      // one > line
+    ListItem,
+    CodeBlock,  // fenced; its lines arrive through codeLine()
+    Table,
+    TableRow,
+    TableCell,
+};
+
+enum class InlineSpan { Code, Bold, Italic, Link, Image };
+constexpr size_t InlineSpanCount = 5;
+
+struct Block {
+    explicit Block(BlockKind kind) : kind(kind) {}
+
+    BlockKind kind;
+    int level = 0;             // Heading: 1 to 6
+    std::string_view marker;   // ListItem: "-", "+", "*" or "12."
+    std::string_view info;     // CodeBlock: whatever follows the opening fence
+    bool separator = false;    // TableRow: a |---|---| row; its cells are empty
+    bool closed = true;        // CodeBlock end: false if the document ended first
+};
+
+// Receives a parsed document as a stream of events. Paragraphs, headings,
+// quotes, list items and table cells hold inline content: text runs and
+// spans, where spans nest inside each other but never inside themselves.
+// A code block may start, and stay open, while a table is still open; and
+// after restoreFence() code lines can arrive without their CodeBlock start.
+// Views passed to a handler are only valid during the call. endBlock gets
+// the fields beginBlock got, except that a code block's end has no info.
+class DocumentHandler {
+public:
+    virtual ~DocumentHandler() = default;
+
+    virtual void beginBlock(const Block& b) = 0;
+    virtual void endBlock(const Block& b) = 0;
+    virtual void text(std::string_view s) = 0;
+    // url is the target of a Link and the source of an Image, else empty.
+    // An Image's alt text arrives as its content.
+    virtual void beginSpan(InlineSpan kind, std::string_view url) = 0;
+    virtual void endSpan(InlineSpan kind, std::string_view url) = 0;
+    virtual void codeLine(std::string_view line) = 0;
+    virtual void rule() = 0;
+    virtual void blankLine() = 0;
+    // No more events; output is complete and flushed
+    virtual void endDocument() = 0;
+};
+
+// Hands every event to several handlers in turn, so that one parse feeds
+// them all
+class DocumentFanout final : public DocumentHandler {
+public:
+    void add(DocumentHandler* h) { handlers.push_back(h); }
+
+    void beginBlock(const Block& b) override {
+        for (DocumentHandler* h : handlers) h->beginBlock(b);
+    }
+    void endBlock(const Block& b) override {
+        for (DocumentHandler* h : handlers) h->endBlock(b);
+    }
+    void text(std::string_view s) override {
+        for (DocumentHandler* h : handlers) h->text(s);
+    }
+    void beginSpan(InlineSpan kind, std::string_view url) override {
+        for (DocumentHandler* h : handlers) h->beginSpan(kind, url);
+    }
+    void endSpan(InlineSpan kind, std::string_view url) override {
+        for (DocumentHandler* h : handlers) h->endSpan(kind, url);
+    }
+    void codeLine(std::string_view line) override {
+        for (DocumentHandler* h : handlers) h->codeLine(line);
+    }
+    void rule() override {
+        for (DocumentHandler* h : handlers) h->rule();
+    }
+    void blankLine() override {
+        for (DocumentHandler* h : handlers) h->blankLine();
+    }
+    void endDocument() override {
+        for (DocumentHandler* h : handlers) h->endDocument();
+    }
+
+private:
+    std::vector<DocumentHandler*> handlers;
+};
+
+} // namespace mdmni
+
+#endif // DOCUMENT_EVENTS_H
@@ -0,0 +1,373 @@
+#include "DocumentParser.h"
+#include "AnsiWriter.h"
+#include "ByteScan.h"
+#include <algorithm>
+#include <cstring>
+
+namespace mdmni {
+
+// Block buffers keep their capacity so the next block reuses it without
+// allocating. After an unusually large block they are freed instead, so one
+// huge paragraph does not pin its memory for the rest of the run.
+constexpr size_t RetainedParagraphBytes = 1 << 20;
+
+namespace {
+
+// Split a markdown table row into trimmed cells, respecting \| escapes. fn is
+// called with each cell; the view is only valid during the call.
+template<typename Fn>
+void forEachTableCell(std::string_view line, std::string& cell, Fn fn) {
+    size_t start = line.find('|');
+    size_t end   = line.rfind('|');
+    if (start == std::string_view::npos || start == end) return;
+
+    auto emit = [&]() {
+        size_t s = cell.find_first_not_of(" \t");
+        size_t e = cell.find_last_not_of(" \t");
+        fn(s == std::string::npos ? std::string_view() : std::string_view(cell).substr(s, e - s + 1));
+        cell.clear();
+    };
+    cell.clear();
+    size_t i = start + 1;
+    while (i < end) {
+        size_t j = i + findTableMarker(line.data() + i, end - i);
+        cell.append(line.data() + i, j - i);
+        if (j == end) break;
+        if (line[j] == '|') {
+            emit();
+            i = j + 1;
+        } else if (j + 1 < end && line[j + 1] == '|') {
+            cell += '|';
+            i = j + 2;
+        } else {
+            cell += '\\';
+            i = j + 1;
+        }
+    }
+    emit();
+}
+
+// Return true if the line is a table separator row (|---|:---:|...|)
+bool isTableSeparatorRow(std::string_view line) {
+    for (char c : line)
+        if (c != '-' && c != ':' && c != '|' && c != ' ' && c != '\t') return false;
+    return line.find('-') != std::string_view::npos;
+}
+
+// Single left-to-right scanner for images, links, emphasis and code spans.
+// Whichever construct opens first wins, so markers inside a code span or a URL
+// are left alone. Closing delimiters are located with forward-only cursors:
+// queries against one cursor arrive with non-decreasing start positions (the
+// scanner only moves right and nested spans are scanned before the text after
+// them), so each cursor keeps its last answer and no byte is searched twice.
+// Spans nest by recursion, but never inside a span sharing their closing
+// cursor: the inner query gets the outer span's end back and fails. That caps
+// the depth at four (link or image, **, *, _ or __) whatever the input.
+// Markers that open nothing stay in the text, and text between spans goes to
+// the handler as one run.
+template<typename Handler>
+class InlineScanner {
+public:
+    InlineScanner(std::string_view text, Handler& handler, RenderStats* stats)
+        : t(text), handler(handler), stats(stats) {}
+
+    void scan(size_t begin, size_t end) {
+        pending = begin;
+        size_t i = begin;
+        while (i < end) {
+            // Skip plain text up to the next marker in one go
+            i += findInlineMarker(t.data() + i, end - i);
+            if (i >= end) break;
+
+            size_t next = 0;
+            switch (t[i]) {
+            case '`': next = codeSpan(i, end); break;
+            case '!': next = image(i, end); break;
+            case '[': next = link(i, end); break;
+            case '*': next = star(i, end); break;
+            case '_': next = underscore(i, end); break;
+            }
+            if (next == 0) {
+                next = i + 1;
+            } else {
+                pending = next;
+            }
+            i = next;
+        }
+        flushText(end);
+    }
+
+private:
+    struct Cursor {
+        size_t next = 0;
+        bool primed = false;
+    };
+
+    std::string_view t;
+    Handler& handler;
+    RenderStats* stats;
+    size_t pending = 0;  // start of text not yet handed over
+    Cursor backtick, rbracket, rparen, underscoreAt, starPair, loneStar;
+
+    // First ch at or after from for which pred holds; memchr skips the rest
+    template<typename Pred>
+    size_t find(Cursor& c, size_t from, char ch, Pred pred) {
+        if (c.primed && from <= c.next) return c.next;
+        size_t i = from;
+        for (;;) {
+            const void* hit = i < t.size() ? std::memchr(t.data() + i, ch, t.size() - i) : nullptr;
+            if (!hit) {
+                i = std::string_view::npos;
+                break;
+            }
+            i = static_cast<const char*>(hit) - t.data();
+            if (pred(i)) break;
+            ++i;
+        }
+        c.next = i;
+        c.primed = true;
+        return c.next;
+    }
+
+    size_t findChar(Cursor& c, size_t from, char ch) {
+        if (c.primed && from <= c.next) return c.next;
+        const void* hit = from < t.size() ? std::memchr(t.data() + from, ch, t.size() - from) : nullptr;
+        c.next = hit ? static_cast<const char*>(hit) - t.data() : std::string_view::npos;
+        c.primed = true;
+        return c.next;
+    }
+
+    void flushText(size_t end) {
+        if (end > pending) handler.text(t.substr(pending, end - pending));
+    }
+
+    // A span starts at i: hand over the text before it
+    void open(InlineSpan span, size_t i, std::string_view url = std::string_view()) {
+        if (stats) stats->inlineSpans[static_cast<size_t>(span)]++;
+        flushText(i);
+        handler.beginSpan(span, url);
+    }
+
+    void styled(InlineSpan span, size_t i, size_t begin, size_t end, std::string_view url = std::string_view()) {
+        open(span, i, url);
+        scan(begin, end);
+        handler.endSpan(span, url);
+    }
+
+    // `code`
+    size_t codeSpan(size_t i, size_t end) {
+        size_t close = findChar(backtick, i + 1, '`');
+        if (close >= end || close == i + 1) return 0;
+        open(InlineSpan::Code, i);
+        handler.text(t.substr(i + 1, close - i - 1));
+        handler.endSpan(InlineSpan::Code, std::string_view());
+        return close + 1;
+    }
+
+    // ![alt](url)
+    size_t image(size_t i, size_t end) {
+        if (i + 1 >= end || t[i + 1] != '[') return 0;
+        size_t rb = findChar(rbracket, i + 2, ']');
+        if (rb >= end || rb + 1 >= end || t[rb + 1] != '(') return 0;
+        size_t rp = findChar(rparen, rb + 2, ')');
+        if (rp >= end || rp == rb + 2) return 0;
+        styled(InlineSpan::Image, i, i + 2, rb, t.substr(rb + 2, rp - rb - 2));
+        return rp + 1;
+    }
+
+    // [text](url)
+    size_t link(size_t i, size_t end) {
+        size_t rb = findChar(rbracket, i + 1, ']');
+        if (rb >= end || rb == i + 1 || rb + 1 >= end || t[rb + 1] != '(') return 0;
+        size_t rp = findChar(rparen, rb + 2, ')');
+        if (rp >= end || rp == rb + 2) return 0;
+        styled(InlineSpan::Link, i, i + 1, rb, t.substr(rb + 2, rp - rb - 2));
+        return rp + 1;
+    }
+
+    // **bold** or *italic*; an italic span may contain **bold** runs
+    size_t star(size_t i, size_t end) {
+        if (i + 1 < end && t[i + 1] == '*') {
+            size_t close = find(starPair, i + 3, '*', [&](size_t k) {
+                return k + 1 < t.size() && t[k + 1] == '*';
+            });
+            if (close != std::string_view::npos && close + 1 < end) {
+                styled(InlineSpan::Bold, i, i + 2, close);
+                return close + 2;
+            }
+            return 0;
+        }
+        size_t close = find(loneStar, i + 1, '*', [&](size_t k) {
+            return t[k - 1] != '*' && (k + 1 >= t.size() || t[k + 1] != '*');
+        });
+        if (close >= end) return 0;
+        styled(InlineSpan::Italic, i, i + 1, close);
+        return close + 1;
+    }
+
+    // __bold__ or _italic_
+    size_t underscore(size_t i, size_t end) {
+        if (i + 1 < end && t[i + 1] == '_') {
+            size_t close = findChar(underscoreAt, i + 2, '_');
+            if (close < end && close > i + 2 && close + 1 < end && t[close + 1] == '_') {
+                styled(InlineSpan::Bold, i, i + 2, close);
+                return close + 2;
+            }
+            return 0;
+        }
+        size_t close = findChar(underscoreAt, i + 1, '_');
+        if (close >= end || close == i + 1) return 0;
+        styled(InlineSpan::Italic, i, i + 1, close);
+        return close + 1;
+    }
+};
+
+} // namespace
+
+template<typename Handler>
+void DocumentParser<Handler>::line(std::string_view line) {
+    if (stats) stats->bytesIn += line.size() + 1;
+
+    // Inside code fences
+    if (fence.inside) {
+        if (stats) stats->codeLines++;
+        if (closesFence(line, fence.fenceChar, fence.fenceLen)) {
+            fence.inside = false;
+            handler.endBlock(Block{BlockKind::CodeBlock});
+        } else {
+            handler.codeLine(line);
+        }
+        return;
+    }
+
+    LineInfo info = classifyLine(line);
+    if (stats) stats->lines[static_cast<size_t>(info.kind)]++;
+    switch (info.kind) {
+    case LineKind::FenceOpen: {
+        // An open paragraph or table stays open across the code block
+        fence.inside = true;
+        fence.fenceChar = info.fenceChar;
+        fence.fenceLen = info.fenceLen;
+        Block b{BlockKind::CodeBlock};
+        b.info = info.text;
+        handler.beginBlock(b);
+        return;
+    }
+
+    case LineKind::Rule:
+        flushParagraph();
+        handler.rule();
+        return;
+
+    case LineKind::Heading:
+    case LineKind::Quote:
+    case LineKind::ListItem: {
+        flushParagraph();
+        Block b{info.kind == LineKind::Heading ? BlockKind::Heading
+                : info.kind == LineKind::Quote ? BlockKind::Quote : BlockKind::ListItem};
+        b.level = info.level;
+        b.marker = info.marker;
+        handler.beginBlock(b);
+        scanInline(info.text);
+        handler.endBlock(b);
+        return;
+    }
+
+    case LineKind::TableRow:
+        if (!tableOpen) flushParagraph();
+        tableRow(line);
+        return;
+
+    case LineKind::Blank:
+        flushParagraph();
+        handler.blankLine();
+        return;
+
+    case LineKind::Text:
+        // Non-table line — end any open table first
+        flushTable();
+        // Lines are joined with single spaces as they arrive
+        if (paragraphLines++) paragraph += ' ';
+        paragraph.append(line.data(), line.size());
+        return;
+    }
+}
+
+template<typename Handler>
+void DocumentParser<Handler>::finish() {
+    // An unterminated fence ends with the document
+    if (fence.inside) {
+        Block b{BlockKind::CodeBlock};
+        b.closed = false;
+        handler.endBlock(b);
+    }
+    fence = FenceState();
+    flushParagraph();
+    handler.endDocument();
+}
+
+template<typename Handler>
+void DocumentParser<Handler>::reset() {
+    fence = FenceState();
+    paragraph.clear();
+    paragraphLines = 0;
+    tableOpen = false;
+}
+
+template<typename Handler>
+void DocumentParser<Handler>::endParagraph() {
+    flushTable();
+    if (paragraphLines == 0) return;
+    if (stats) stats->peakParagraphBytes = std::max<uint64_t>(stats->peakParagraphBytes, paragraph.size());
+    Block b{BlockKind::Paragraph};
+    handler.beginBlock(b);
+    scanInline(paragraph);
+    handler.endBlock(b);
+    paragraph.clear();
+    paragraphLines = 0;
+    if (paragraph.capacity() > RetainedParagraphBytes) std::string().swap(paragraph);
+}
+
+template<typename Handler>
+void DocumentParser<Handler>::endTable() {
+    PhaseScope phase(stats, Phase::Table);
+    tableOpen = false;
+    handler.endBlock(Block{BlockKind::Table});
+}
+
+// Report a table row cell by cell as it arrives. A separator row's cells
+// come with no content, so handlers still learn how many columns it has.
+template<typename Handler>
+void DocumentParser<Handler>::tableRow(std::string_view line) {
+    PhaseScope phase(stats, Phase::Table);
+    if (!tableOpen) {
+        tableOpen = true;
+        handler.beginBlock(Block{BlockKind::Table});
+    }
+    Block row{BlockKind::TableRow};
+    row.separator = isTableSeparatorRow(line);
+    handler.beginBlock(row);
+    const Block cell{BlockKind::TableCell};
+    forEachTableCell(line, cellScratch, [&](std::string_view text) {
+        handler.beginBlock(cell);
+        if (!row.separator) scanInline(text);
+        handler.endBlock(cell);
+    });
+    handler.endBlock(row);
+}
+
+template<typename Handler>
+void DocumentParser<Handler>::scanInline(std::string_view text) {
+    PhaseScope phase(stats, Phase::Inline);
+    InlineScanner<Handler>(text, handler, stats).scan(0, text.size());
+}
+
+// The renderer's own writer, with direct calls, and any other handler
+// through the virtual interface
+template class DocumentParser<AnsiWriter<true, true>>;
+template class DocumentParser<AnsiWriter<true, false>>;
+template class DocumentParser<AnsiWriter<false, true>>;
+template class DocumentParser<AnsiWriter<false, false>>;
+template class DocumentParser<DocumentHandler>;
+
+} // namespace mdmni
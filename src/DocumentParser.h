@@ -0,0 +1,60 @@
+#ifndef DOCUMENT_PARSER_H
+#define DOCUMENT_PARSER_H
+
+#include <string>
+#include <string_view>
+#include "DocumentEvents.h"
+#include "LineClassifier.h"
+#include "RenderStats.h"
+
+namespace mdmni {
+
+// Turns markdown lines into DocumentHandler events. Paragraphs are buffered
+// until they end; everything else is reported as soon as its line arrives,
+// and table rows one by one as they come. Handler is DocumentHandler to feed
+// any handler through virtual calls, or a final handler class such as
+// AnsiWriter<Color, Urls>, whose calls are then resolved, and mostly
+// inlined, at compile time.
+template<typename Handler>
+class DocumentParser {
+public:
+    explicit DocumentParser(Handler& h) : handler(h) {}
+
+    // One input line, without its newline
+    void line(std::string_view line);
+    // End the document: flush whatever block is open, then endDocument()
+    void finish();
+    // Forget any partial block and fence state, keeping allocated buffers
+    void reset();
+    // Resume at a BlockIndex checkpoint. The parser must not hold a partial block.
+    void restoreFence(const FenceState& fence) { this->fence = fence; }
+
+    // Count input lines, bytes and spans into s and charge inline and table
+    // work to their phases; nullptr stops
+    void setStats(RenderStats* s) { stats = StatsCompiled ? s : nullptr; }
+
+private:
+    Handler& handler;
+    FenceState fence;
+    std::string paragraph;  // text lines so far, joined with spaces
+    size_t paragraphLines = 0;
+    bool tableOpen = false;
+    std::string cellScratch;
+    RenderStats* stats = nullptr;
+
+    // End the open paragraph and table, if any; most lines have neither
+    void flushParagraph() {
+        if (paragraphLines || tableOpen) endParagraph();
+    }
+    void flushTable() {
+        if (tableOpen) endTable();
+    }
+    void endParagraph();
+    void endTable();
+    void tableRow(std::string_view line);
+    void scanInline(std::string_view text);
+};
+
+} // namespace mdmni
+
+#endif // DOCUMENT_PARSER_H
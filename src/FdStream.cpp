@@ -0,0 +1,24 @@
+#include "FdStream.h"
+#include <cerrno>
+#include <unistd.h>
+
+namespace mdmni {
+
+std::streamsize FdStreamBuf::xsputn(const char* s, std::streamsize n) {
+    std::streamsize done = 0;
+    while (done < n) {
+        ssize_t w = ::write(fd, s + done, static_cast<size_t>(n - done));
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) break;
+        done += w;
+    }
+    return done;
+}
+
+FdStreamBuf::int_type FdStreamBuf::overflow(int_type c) {
+    if (traits_type::eq_int_type(c, traits_type::eof())) return traits_type::not_eof(c);
+    char ch = traits_type::to_char_type(c);
+    return xsputn(&ch, 1) == 1 ? c : traits_type::eof();
+}
+
+} // namespace mdmni
@@ -0,0 +1,35 @@
+#ifndef FD_STREAM_H
+#define FD_STREAM_H
+
+#include <ostream>
+#include <streambuf>
+
+namespace mdmni {
+
+// Unbuffered streambuf writing straight to a file descriptor. The renderer
+// already buffers its output, so every write here is one large write(2).
+// A failed write (EPIPE once a pager has quit, for instance) puts the
+// stream into a failed state instead of raising SIGPIPE-style errors.
+class FdStreamBuf : public std::streambuf {
+public:
+    explicit FdStreamBuf(int fd) : fd(fd) {}
+
+protected:
+    std::streamsize xsputn(const char* s, std::streamsize n) override;
+    int_type overflow(int_type c) override;
+
+private:
+    int fd;
+};
+
+class FdOStream : public std::ostream {
+public:
+    explicit FdOStream(int fd) : std::ostream(nullptr), buf(fd) { rdbuf(&buf); }
+
+private:
+    FdStreamBuf buf;
+};
+
+} // namespace mdmni
+
+#endif // FD_STREAM_H
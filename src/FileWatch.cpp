@@ -0,0 +1,39 @@
+#include "FileWatch.h"
+#include <cerrno>
+#include <cstring>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace mdmni {
+
+FileWatch::FileWatch(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    name = slash == std::string::npos ? path : path.substr(slash + 1);
+
+    fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) return;
+    wd = inotify_add_watch(fd, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+}
+
+FileWatch::~FileWatch() {
+    if (fd >= 0) ::close(fd);
+}
+
+bool FileWatch::changed() {
+    bool hit = false;
+    alignas(inotify_event) char buf[4096];
+    for (;;) {
+        ssize_t n = ::read(fd, buf, sizeof buf);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        for (ssize_t i = 0; i < n;) {
+            const inotify_event* ev = reinterpret_cast<const inotify_event*>(buf + i);
+            if (ev->len && name == ev->name) hit = true;
+            i += static_cast<ssize_t>(sizeof(inotify_event) + ev->len);
+        }
+    }
+    return hit;
+}
+
+} // namespace mdmni
@@ -0,0 +1,32 @@
+#ifndef FILE_WATCH_H
+#define FILE_WATCH_H
+
+#include <string>
+
+namespace mdmni {
+
+// Reports when a file has been saved, using inotify on its directory so that
+// editors which write a new file and rename it over the old one are seen too.
+// Only completed writes count; a file still being written is not reported.
+class FileWatch {
+public:
+    explicit FileWatch(const std::string& path);
+    ~FileWatch();
+    FileWatch(const FileWatch&) = delete;
+    FileWatch& operator=(const FileWatch&) = delete;
+
+    bool valid() const { return wd >= 0; }
+    // Becomes readable when events are pending
+    int descriptor() const { return fd; }
+    // Consume pending events without blocking; true if any was for the file
+    bool changed();
+
+private:
+    int fd = -1;
+    int wd = -1;
+    std::string name;
+};
+
+} // namespace mdmni
+
+#endif // FILE_WATCH_H
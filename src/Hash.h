@@ -0,0 +1,14 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace mdmni {
+
+// XXH64, fast enough that hashing is noise next to rendering
+uint64_t xxh64(const char* p, size_t len, uint64_t seed = 0);
+
+} // namespace mdmni
+
+#endif // HASH_H
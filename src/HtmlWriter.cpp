@@ -0,0 +1,268 @@
+#include "HtmlWriter.h"
+
+namespace mdmni {
+
+namespace {
+
+const char* const HeadingOpen[6] = { "<h1>", "<h2>", "<h3>", "<h4>", "<h5>", "<h6>" };
+const char* const HeadingClose[6] = { "</h1>\n", "</h2>\n", "</h3>\n", "</h4>\n", "</h5>\n", "</h6>\n" };
+
+int headingIndex(int level) {
+    return level < 1 ? 0 : level > 6 ? 5 : level - 1;
+}
+
+// Relative URLs and http, https and mailto ones. Anything with another
+// scheme (javascript:, data:, ...) would run or load something in the page
+// showing the fragment. A colon before any "/", "?" or "#" starts a scheme;
+// whitespace or control characters in it, which browsers strip, do not make
+// it safe.
+bool safeUrl(std::string_view url) {
+    size_t end = url.find_first_of(":/?#");
+    if (end == std::string_view::npos || url[end] != ':') return true;
+    std::string_view scheme = url.substr(0, end);
+    for (std::string_view allowed : { "http", "https", "mailto" }) {
+        if (scheme.size() != allowed.size()) continue;
+        bool same = true;
+        for (size_t i = 0; i < scheme.size() && same; ++i)
+            same = (scheme[i] | 0x20) == allowed[i];
+        if (same) return true;
+    }
+    return false;
+}
+
+} // namespace
+
+void HtmlWriter::beginBlock(const Block& b) {
+    switch (b.kind) {
+    case BlockKind::Paragraph:
+        closeGroup();
+        sink << "<p>";
+        return;
+    case BlockKind::Heading:
+        closeGroup();
+        sink << HeadingOpen[headingIndex(b.level)];
+        return;
+    case BlockKind::Quote:
+        openGroup(Group::Quote, std::string_view());
+        return;
+    case BlockKind::ListItem:
+        openGroup(b.marker.back() == '.' ? Group::OrderedList : Group::BulletList, b.marker);
+        sink << "<li>";
+        return;
+    case BlockKind::CodeBlock: {
+        closeGroup();
+        // The first word of the info string names the language
+        std::string_view lang = b.info.substr(0, b.info.find_first_of(" \t"));
+        sink << "<pre><code";
+        if (!lang.empty()) {
+            sink << " class=\"language-";
+            writeEscaped(lang);
+            sink << '"';
+        }
+        sink << '>';
+        return;
+    }
+    case BlockKind::Table:
+        closeGroup();
+        return;
+    case BlockKind::TableRow:
+        tableRows.push_back(TableRow{tableCellEnds.size(), 0, b.separator});
+        return;
+    case BlockKind::TableCell:
+        cell = &tableText;
+        return;
+    }
+}
+
+void HtmlWriter::endBlock(const Block& b) {
+    switch (b.kind) {
+    case BlockKind::Paragraph:
+        sink << "</p>\n";
+        return;
+    case BlockKind::Heading:
+        sink << HeadingClose[headingIndex(b.level)];
+        return;
+    case BlockKind::Quote:
+        sink.newline();
+        return;
+    case BlockKind::ListItem:
+        sink << "</li>\n";
+        return;
+    case BlockKind::CodeBlock:
+        sink << "</code></pre>\n";
+        return;
+    case BlockKind::Table:
+        writeTable();
+        return;
+    case BlockKind::TableRow:
+        return;
+    case BlockKind::TableCell:
+        cell = nullptr;
+        if (tableRows.back().separator) return;
+        tableCellEnds.push_back(tableText.size());
+        ++tableRows.back().cellCount;
+        return;
+    }
+}
+
+void HtmlWriter::text(std::string_view s) {
+    if (inImage) altText.append(s.data(), s.size());
+    else writeEscaped(s);
+}
+
+void HtmlWriter::beginSpan(InlineSpan kind, std::string_view url) {
+    if (inImage) return;
+    switch (kind) {
+    case InlineSpan::Code: write("<code>"); return;
+    case InlineSpan::Bold: write("<strong>"); return;
+    case InlineSpan::Italic: write("<em>"); return;
+    case InlineSpan::Link:
+        // An unsafe link is left as its text
+        if (!safeUrl(url)) return;
+        write("<a href=\"");
+        writeEscaped(url);
+        write("\">");
+        return;
+    case InlineSpan::Image:
+        // Written at its end, once the alt text is known
+        inImage = true;
+        altText.clear();
+        return;
+    }
+}
+
+void HtmlWriter::endSpan(InlineSpan kind, std::string_view url) {
+    if (inImage && kind != InlineSpan::Image) return;
+    switch (kind) {
+    case InlineSpan::Code: write("</code>"); return;
+    case InlineSpan::Bold: write("</strong>"); return;
+    case InlineSpan::Italic: write("</em>"); return;
+    case InlineSpan::Link:
+        if (safeUrl(url)) write("</a>");
+        return;
+    case InlineSpan::Image:
+        inImage = false;
+        if (!safeUrl(url)) {
+            writeEscaped(altText);
+            return;
+        }
+        write("<img src=\"");
+        writeEscaped(url);
+        write("\" alt=\"");
+        writeEscaped(altText);
+        write("\">");
+        return;
+    }
+}
+
+void HtmlWriter::codeLine(std::string_view line) {
+    writeEscaped(line);
+    sink.newline();
+}
+
+void HtmlWriter::rule() {
+    closeGroup();
+    sink << "<hr>\n";
+}
+
+// A blank line ends a quote; list items around it stay in one list
+void HtmlWriter::blankLine() {
+    if (group == Group::Quote) closeGroup();
+}
+
+void HtmlWriter::endDocument() {
+    closeGroup();
+    sink.detach();
+}
+
+// Copy s with &, <, > and " replaced by entities
+void HtmlWriter::writeEscaped(std::string_view s) {
+    size_t from = 0;
+    for (size_t i = 0; i < s.size(); ++i) {
+        const char* entity;
+        switch (s[i]) {
+        case '&': entity = "&amp;"; break;
+        case '<': entity = "&lt;"; break;
+        case '>': entity = "&gt;"; break;
+        case '"': entity = "&quot;"; break;
+        default: continue;
+        }
+        write(s.substr(from, i - from));
+        write(entity);
+        from = i + 1;
+    }
+    write(s.substr(from));
+}
+
+void HtmlWriter::openGroup(Group g, std::string_view marker) {
+    if (group == g) return;
+    closeGroup();
+    group = g;
+    switch (g) {
+    case Group::Quote:
+        sink << "<blockquote>\n";
+        return;
+    case Group::BulletList:
+        sink << "<ul>\n";
+        return;
+    case Group::OrderedList: {
+        // An ordered list keeps the number of its first item
+        std::string_view number = marker.substr(0, marker.size() - 1);
+        if (number == "1") {
+            sink << "<ol>\n";
+        } else {
+            sink << "<ol start=\"" << number << "\">\n";
+        }
+        return;
+    }
+    case Group::None:
+        return;
+    }
+}
+
+void HtmlWriter::closeGroup() {
+    switch (group) {
+    case Group::Quote: sink << "</blockquote>\n"; break;
+    case Group::BulletList: sink << "</ul>\n"; break;
+    case Group::OrderedList: sink << "</ol>\n"; break;
+    case Group::None: break;
+    }
+    group = Group::None;
+}
+
+void HtmlWriter::writeTable() {
+    // Rows above the first separator row are the header, if there is one
+    size_t headerRows = 0;
+    while (headerRows < tableRows.size() && !tableRows[headerRows].separator) ++headerRows;
+    if (headerRows == tableRows.size()) headerRows = 0;
+
+    sink << "<table>\n";
+    bool body = false;
+    for (size_t r = 0; r < tableRows.size(); ++r) {
+        const TableRow& row = tableRows[r];
+        if (row.separator) continue;
+        bool header = r < headerRows;
+        if (r == 0 && header) sink << "<thead>\n";
+        if (!header && !body) {
+            if (headerRows) sink << "</thead>\n";
+            sink << "<tbody>\n";
+            body = true;
+        }
+        sink << "<tr>";
+        for (size_t c = row.firstCell; c < row.firstCell + row.cellCount; ++c) {
+            size_t begin = c ? tableCellEnds[c - 1] : 0;
+            sink << (header ? "<th>" : "<td>");
+            sink << std::string_view(tableText).substr(begin, tableCellEnds[c] - begin);
+            sink << (header ? "</th>" : "</td>");
+        }
+        sink << "</tr>\n";
+    }
+    if (body) sink << "</tbody>\n";
+    else if (headerRows) sink << "</thead>\n";
+    sink << "</table>\n";
+    tableText.clear();
+    tableCellEnds.clear();
+    tableRows.clear();
+}
+
+} // namespace mdmni
@@ -0,0 +1,57 @@
+#ifndef HTML_WRITER_H
+#define HTML_WRITER_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "DocumentEvents.h"
+#include "OutputSink.h"
+
+namespace mdmni {
+
+// An HTML fragment for the web view. Consecutive list items share one <ul>
+// or <ol> (blank lines between them included) and consecutive quote lines
+// one <blockquote>. Tables are written once complete, with the rows above
+// the first separator row as their header.
+class HtmlWriter final : public DocumentHandler {
+public:
+    OutputSink& output() { return sink; }
+
+    void beginBlock(const Block& b) override;
+    void endBlock(const Block& b) override;
+    void text(std::string_view s) override;
+    void beginSpan(InlineSpan kind, std::string_view url) override;
+    void endSpan(InlineSpan kind, std::string_view url) override;
+    void codeLine(std::string_view line) override;
+    void rule() override;
+    void blankLine() override;
+    void endDocument() override;
+
+private:
+    enum class Group { None, Quote, BulletList, OrderedList };
+
+    OutputSink sink;
+    Group group = Group::None;
+    std::string* cell = nullptr;  // inline content of a table cell goes here
+    bool inImage = false;         // text is the alt text of an image
+    std::string altText;
+
+    // The open table: cell markup in tableText, cell i ending at tableCellEnds[i]
+    struct TableRow { size_t firstCell; size_t cellCount; bool separator; };
+    std::string tableText;
+    std::vector<size_t> tableCellEnds;
+    std::vector<TableRow> tableRows;
+
+    void write(std::string_view s) {
+        if (cell) cell->append(s.data(), s.size());
+        else sink << s;
+    }
+    void writeEscaped(std::string_view s);
+    void openGroup(Group g, std::string_view marker);
+    void closeGroup();
+    void writeTable();
+};
+
+} // namespace mdmni
+
+#endif // HTML_WRITER_H
@@ -0,0 +1,146 @@
+#include "InputSource.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mdmni {
+
+std::unique_ptr<InputSource> InputSource::open(const std::string& path) {
+    if (path.empty() || path == "-") return fromFd(STDIN_FILENO, false);
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return nullptr;
+    return fromFd(fd, true);
+}
+
+std::unique_ptr<InputSource> InputSource::fromFd(int fd, bool ownsFd) {
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        // stdin redirected from a file may already be partly consumed
+        off_t offset = lseek(fd, 0, SEEK_CUR);
+        if (offset < 0) offset = 0;
+        if (offset <= st.st_size) {
+            auto m = std::make_unique<MappedInput>(fd, static_cast<size_t>(offset),
+                                                   static_cast<size_t>(st.st_size));
+            if (m->valid()) {
+                if (ownsFd) ::close(fd);
+                return m;
+            }
+        }
+    }
+    return std::make_unique<FdInput>(fd, ownsFd);
+}
+
+//
+// MemoryInput
+//
+
+bool MemoryInput::nextLine(std::string_view& line) {
+    if (pos >= end) return false;
+    const char* nl = static_cast<const char*>(std::memchr(pos, '\n', static_cast<size_t>(end - pos)));
+    const char* stop = nl ? nl : end;
+    line = trimCr(pos, static_cast<size_t>(stop - pos));
+    pos = nl ? nl + 1 : end;
+    return true;
+}
+
+std::string_view MemoryInput::remaining(std::string&) {
+    std::string_view rest(pos, static_cast<size_t>(end - pos));
+    pos = end;
+    return rest;
+}
+
+//
+// MappedInput
+//
+
+MappedInput::MappedInput(int fd, size_t offset, size_t size_) : size(size_) {
+    if (size == 0) return;
+    void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) return;
+    madvise(p, size, MADV_SEQUENTIAL);
+    base = p;
+    mapped = size;
+    reset(std::string_view(static_cast<const char*>(p) + offset, size - offset));
+}
+
+MappedInput::~MappedInput() {
+    if (base) munmap(base, mapped);
+}
+
+//
+// FdInput
+//
+
+FdInput::FdInput(int fd_, bool ownsFd_) : fd(fd_), ownsFd(ownsFd_), buf(ChunkSize) {}
+
+FdInput::~FdInput() {
+    if (ownsFd) ::close(fd);
+}
+
+// Read one more chunk, compacting or growing the buffer so that a partial
+// line at the end is kept whole. Returns false at end of input.
+bool FdInput::fill() {
+    if (eof) return false;
+    if (begin > 0) {
+        std::memmove(buf.data(), buf.data() + begin, filled - begin);
+        filled -= begin;
+        begin = 0;
+    }
+    if (buf.size() - filled < ChunkSize / 2) buf.resize(buf.size() * 2);
+    for (;;) {
+        ssize_t n = ::read(fd, buf.data() + filled, buf.size() - filled);
+        if (n > 0) {
+            filled += static_cast<size_t>(n);
+            return true;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // A non-blocking descriptor (stdin shared with another process,
+            // say): wait until there is more to read
+            pollfd p{fd, POLLIN, 0};
+            if (poll(&p, 1, -1) >= 0 || errno == EINTR) continue;
+        }
+        if (n < 0) readError = errno;
+        eof = true;
+        return false;
+    }
+}
+
+bool FdInput::nextLine(std::string_view& line) {
+    size_t scanned = begin;
+    for (;;) {
+        const char* nl = static_cast<const char*>(
+            std::memchr(buf.data() + scanned, '\n', filled - scanned));
+        if (nl) {
+            size_t stop = static_cast<size_t>(nl - buf.data());
+            line = trimCr(buf.data() + begin, stop - begin);
+            begin = stop + 1;
+            return true;
+        }
+        scanned = filled - begin;
+        if (!fill()) break;
+    }
+    if (begin == filled) return false;
+    // Last line without a trailing newline
+    line = trimCr(buf.data() + begin, filled - begin);
+    begin = filled;
+    return true;
+}
+
+std::string_view FdInput::remaining(std::string& storage) {
+    while (fill()) {}
+    storage.assign(buf.data() + begin, filled - begin);
+    std::vector<char>().swap(buf);
+    begin = filled = 0;
+    return storage;
+}
+
+bool FdInput::ready() {
+    return eof || std::memchr(buf.data() + begin, '\n', filled - begin) != nullptr;
+}
+
+} // namespace mdmni
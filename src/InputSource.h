@@ -0,0 +1,106 @@
+#ifndef INPUT_SOURCE_H
+#define INPUT_SOURCE_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace mdmni {
+
+// Line-oriented input without a std::string per line. Lines are returned as
+// views (newline and a trailing '\r' removed) that stay valid until the next
+// call to nextLine().
+class InputSource {
+public:
+    virtual ~InputSource() = default;
+
+    // Open a file, or stdin for "" and "-". Returns nullptr if it cannot be opened.
+    static std::unique_ptr<InputSource> open(const std::string& path);
+    // Regular files are memory-mapped, anything else is read in chunks
+    static std::unique_ptr<InputSource> fromFd(int fd, bool ownsFd);
+
+    // Fetch the next line; false at end of input
+    virtual bool nextLine(std::string_view& line) = 0;
+    // True if nextLine() can return without waiting for more input
+    virtual bool ready() = 0;
+    // True if the whole input is already in memory (a mapped file or a buffer)
+    virtual bool complete() const = 0;
+    // Everything not consumed yet. Streamed input is read to the end into
+    // storage first; the view stays valid as long as this source and storage do.
+    virtual std::string_view remaining(std::string& storage) = 0;
+    // errno of a read error that ended the input early, or 0
+    virtual int error() const { return 0; }
+
+protected:
+    static std::string_view trimCr(const char* data, size_t n) {
+        if (n && data[n - 1] == '\r') --n;
+        return std::string_view(data, n);
+    }
+};
+
+// A document already in memory, split into lines in place
+class MemoryInput : public InputSource {
+public:
+    MemoryInput() = default;
+    explicit MemoryInput(std::string_view data) { reset(data); }
+
+    void reset(std::string_view data) {
+        pos = data.data();
+        end = data.data() + data.size();
+    }
+
+    bool nextLine(std::string_view& line) override;
+    bool ready() override { return true; }
+    bool complete() const override { return true; }
+    std::string_view remaining(std::string&) override;
+
+private:
+    const char* pos = nullptr;
+    const char* end = nullptr;
+};
+
+// A regular file mapped into memory
+class MappedInput : public MemoryInput {
+public:
+    MappedInput(int fd, size_t offset, size_t size);
+    ~MappedInput() override;
+
+    bool valid() const { return base != nullptr || size == 0; }
+
+private:
+    void* base = nullptr;
+    size_t mapped = 0;
+    size_t size;
+};
+
+// Chunked read(2) reader for stdin, pipes and terminals
+class FdInput : public InputSource {
+public:
+    static constexpr size_t ChunkSize = 64 * 1024;
+
+    FdInput(int fd, bool ownsFd);
+    ~FdInput() override;
+
+    bool nextLine(std::string_view& line) override;
+    bool ready() override;
+    bool complete() const override { return false; }
+    std::string_view remaining(std::string& storage) override;
+    int error() const override { return readError; }
+
+private:
+    int fd;
+    bool ownsFd;
+    bool eof = false;
+    int readError = 0;
+    std::vector<char> buf;
+    size_t begin = 0;   // start of unconsumed data
+    size_t filled = 0;  // end of valid data
+
+    bool fill();
+};
+
+} // namespace mdmni
+
+#endif // INPUT_SOURCE_H
@@ -0,0 +1,146 @@
+#include "LineClassifier.h"
+
+namespace mdmni {
+
+// Whitespace as matched by \s and isspace() in the C locale
+static inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\n' || c == '\v' || c == '\f' || c == '\r';
+}
+
+static inline bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+// ``` or ~~~ (3+ of the same char); the rest of the line may not contain fence chars
+static bool matchFence(std::string_view line, size_t i, LineInfo& info) {
+    char c = line[i];
+    size_t run = i;
+    while (run < line.size() && line[run] == c) ++run;
+    if (run - i < 3) return false;
+    for (size_t k = run; k < line.size(); ++k)
+        if (line[k] == '`' || line[k] == '~') return false;
+    info.kind = LineKind::FenceOpen;
+    info.fenceChar = c;
+    info.fenceLen = static_cast<int>(run - i);
+    while (run < line.size() && isBlank(line[run])) ++run;
+    info.text = line.substr(run);
+    return true;
+}
+
+// Three or more of -, * or _ with nothing but whitespace in between
+static bool matchRule(std::string_view line, size_t i) {
+    int marks = 0;
+    for (; i < line.size(); ++i) {
+        char c = line[i];
+        if (c == '-' || c == '*' || c == '_') ++marks;
+        else if (!isBlank(c)) return false;
+    }
+    return marks >= 3;
+}
+
+// Bullet marker ending just before line[i], followed by at least one blank
+static bool matchListItem(std::string_view line, size_t markerStart, size_t i, LineInfo& info) {
+    if (i >= line.size() || !isBlank(line[i])) return false;
+    info.kind = LineKind::ListItem;
+    info.marker = line.substr(markerStart, i - markerStart);
+    while (i < line.size() && isBlank(line[i])) ++i;
+    info.text = line.substr(i);
+    return true;
+}
+
+LineInfo classifyLine(std::string_view line) {
+    LineInfo info;
+    size_t i = 0;
+    while (i < line.size() && isBlank(line[i])) ++i;
+    if (i == line.size()) {
+        // Only space, tab, CR and LF make a blank line; \v and \f are kept as text
+        info.kind = line.find_first_not_of(" \t\r\n") == std::string_view::npos ? LineKind::Blank : LineKind::Text;
+        return info;
+    }
+
+    char c = line[i];
+    switch (c) {
+    case '`':
+    case '~':
+        matchFence(line, i, info);
+        break;
+    case '#': {
+        if (i != 0) break;
+        size_t run = 0;
+        while (run < line.size() && line[run] == '#') ++run;
+        if (run > 6 || run >= line.size() || !isBlank(line[run])) break;
+        size_t t = run;
+        while (t < line.size() && isBlank(line[t])) ++t;
+        info.kind = LineKind::Heading;
+        info.level = static_cast<int>(run);
+        info.text = line.substr(t);
+        break;
+    }
+    case '>': {
+        size_t t = i;
+        while (t < line.size() && (line[t] == '>' || isBlank(line[t]))) ++t;
+        info.kind = LineKind::Quote;
+        info.text = line.substr(t);
+        break;
+    }
+    case '-':
+    case '*':
+    case '_':
+        if (matchRule(line, i)) {
+            info.kind = LineKind::Rule;
+            break;
+        }
+        if (c != '_') matchListItem(line, i, i + 1, info);
+        break;
+    case '+':
+        matchListItem(line, i, i + 1, info);
+        break;
+    case '|': {
+        size_t last = line.size();
+        while (last > i && isBlank(line[last - 1])) --last;
+        if (last - i >= 2 && line[last - 1] == '|') info.kind = LineKind::TableRow;
+        break;
+    }
+    default:
+        if (isDigit(c)) {
+            size_t t = i;
+            while (t < line.size() && isDigit(line[t])) ++t;
+            if (t < line.size() && line[t] == '.') matchListItem(line, i, t + 1, info);
+        }
+        break;
+    }
+    return info;
+}
+
+bool closesFence(std::string_view line, char fenceChar, int fenceLen) {
+    if (fenceChar == '\0' || fenceLen <= 0) return false;
+    // Trim leading whitespace, then count same-char run at start; valid close if run char matches and length >= opener length,
+    // and the rest of the line is only whitespace.
+    size_t i = 0;
+    while (i < line.size() && (line[i] == ' ' || line[i] == '\t')) ++i;
+    int run = 0;
+    while (i < line.size() && line[i] == fenceChar) { ++run; ++i; }
+    while (i < line.size()) { if (line[i] != ' ' && line[i] != '\t') return false; ++i; }
+    return run >= fenceLen && run >= 3;
+}
+
+LineInfo FenceState::advance(std::string_view line) {
+    LineInfo info;
+    if (inside) {
+        if (closesFence(line, fenceChar, fenceLen)) inside = false;
+        return info;
+    }
+    size_t i = 0;
+    while (i < line.size() && isBlank(line[i])) ++i;
+    if (i == line.size() || line[i] == '`' || line[i] == '~' || (i == 0 && line[0] == '#')) {
+        info = classifyLine(line);
+        if (info.kind == LineKind::FenceOpen) {
+            inside = true;
+            fenceChar = info.fenceChar;
+            fenceLen = info.fenceLen;
+        }
+    }
+    return info;
+}
+
+} // namespace mdmni
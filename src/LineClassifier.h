@@ -0,0 +1,59 @@
+#ifndef LINE_CLASSIFIER_H
+#define LINE_CLASSIFIER_H
+
+#include <cstddef>
+#include <string_view>
+
+namespace mdmni {
+
+// Block-level kind of a single input line outside code fences
+enum class LineKind {
+    Blank,
+    Text,       // paragraph text
+    FenceOpen,  // ``` or ~~~ with an optional info string
+    Rule,       // ---, ***, ___ (spaces allowed)
+    Heading,    // # .. ###### at column 0
+    Quote,      // > ...
+    ListItem,   // -, +, * or 1. followed by whitespace
+    TableRow    // | ... |
+};
+constexpr size_t LineKindCount = 8;
+
+struct LineInfo {
+    LineKind kind = LineKind::Text;
+    int level = 0;            // heading level
+    char fenceChar = '\0';    // fence opener character
+    int fenceLen = 0;         // fence opener run length
+    std::string_view marker;  // list bullet: "-", "+", "*" or "12."
+    std::string_view text;    // heading, quote or list item content; fence info
+};
+
+// Classify a line in one scan, dispatching on its first non-blank byte.
+// Never allocates.
+LineInfo classifyLine(std::string_view line);
+
+// True if line closes a fence opened with fenceLen fenceChar characters
+bool closesFence(std::string_view line, char fenceChar, int fenceLen);
+
+// Fence open/close tracking with the renderer's rules, for scanners that
+// only need block boundaries and not a full classification
+struct FenceState {
+    char fenceChar = '\0';
+    int fenceLen = 0;
+    bool inside = false;
+
+    // Advance past line and classify it as far as block boundaries need:
+    // blank lines, fence openers and headings outside fences are reported
+    // as such; everything else, including every line inside a fence, is Text.
+    LineInfo advance(std::string_view line);
+
+    // Same effect on the lines that follow; the fence of a closed block is
+    // left behind in fenceChar and fenceLen but no longer matters
+    bool operator==(const FenceState& o) const {
+        return inside == o.inside && (!inside || (fenceChar == o.fenceChar && fenceLen == o.fenceLen));
+    }
+};
+
+} // namespace mdmni
+
+#endif // LINE_CLASSIFIER_H
@@ -0,0 +1,105 @@
+#include "Outline.h"
+#include "DocumentParser.h"
+#include "PlainWriter.h"
+
+namespace mdmni {
+
+void trimTitle(std::string& title) {
+    while (!title.empty() && (title.back() == '\n' || title.back() == ' ' || title.back() == '\t'))
+        title.pop_back();
+}
+
+size_t OutlineNumbering::next(int level, std::string& number) {
+    // Siblings and anything deeper end here
+    while (!open.empty() && open.back() >= level) open.pop_back();
+    open.push_back(level);
+    size_t depth = open.size();
+    counts.resize(depth, 0);
+    ++counts[depth - 1];
+    number.clear();
+    for (size_t i = 0; i < depth; ++i) {
+        if (i) number += '.';
+        number += std::to_string(counts[i]);
+    }
+    return depth;
+}
+
+std::vector<Section> buildOutline(BlockIndex& index) {
+    index.extendAll();
+    std::string_view doc = index.document();
+    const std::vector<HeadingMark>& headings = index.headings();
+
+    // Titles come from the heading lines alone, through the usual parser
+    PlainWriter plain;
+    DocumentParser<DocumentHandler> parser(plain);
+    OutlineNumbering numbering;
+    std::vector<Section> outline;
+    outline.reserve(headings.size());
+    std::vector<size_t> open;  // sections still waiting for their end
+    for (const HeadingMark& h : headings) {
+        while (!open.empty() && outline[open.back()].level >= h.level) {
+            outline[open.back()].end = h.offset;
+            open.pop_back();
+        }
+        Section s;
+        s.offset = h.offset;
+        s.end = doc.size();
+        s.level = h.level;
+        s.depth = numbering.next(h.level, s.number);
+        size_t lineEnd = static_cast<size_t>(h.text.data() + h.text.size() - doc.data());
+        plain.output().attach(s.title);
+        parser.line(doc.substr(h.offset, lineEnd - h.offset));
+        parser.finish();
+        trimTitle(s.title);
+        open.push_back(outline.size());
+        outline.push_back(std::move(s));
+    }
+    return outline;
+}
+
+namespace {
+
+bool isOutlineNumber(std::string_view s) {
+    if (s.empty()) return false;
+    for (char c : s)
+        if ((c < '0' || c > '9') && c != '.') return false;
+    return true;
+}
+
+bool equalsIgnoringCase(std::string_view a, std::string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        char x = a[i] >= 'A' && a[i] <= 'Z' ? static_cast<char>(a[i] - 'A' + 'a') : a[i];
+        char y = b[i] >= 'A' && b[i] <= 'Z' ? static_cast<char>(b[i] - 'A' + 'a') : b[i];
+        if (x != y) return false;
+    }
+    return true;
+}
+
+} // namespace
+
+const Section* findSection(const std::vector<Section>& outline, std::string_view query) {
+    // A trailing dot is allowed: "3." is section 3
+    if (isOutlineNumber(query)) {
+        std::string_view number = query.back() == '.' ? query.substr(0, query.size() - 1) : query;
+        for (const Section& s : outline)
+            if (s.number == number) return &s;
+    }
+    for (const Section& s : outline)
+        if (s.title == query) return &s;
+    for (const Section& s : outline)
+        if (equalsIgnoringCase(s.title, query)) return &s;
+    return nullptr;
+}
+
+void writeOutline(const std::vector<Section>& outline, std::string& out) {
+    for (const Section& s : outline) {
+        out.append(2 * (s.depth - 1), ' ');
+        out += s.number;
+        out += ' ';
+        out += s.title;
+        out += '\n';
+    }
+}
+
+} // namespace mdmni
@@ -0,0 +1,53 @@
+#ifndef OUTLINE_H
+#define OUTLINE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "BlockIndex.h"
+
+namespace mdmni {
+
+// Numbers headings as an outline ("3", "3.2", ...): a heading nests under
+// the closest heading before it with a lower level, so skipped levels add
+// no empty steps
+class OutlineNumbering {
+public:
+    // Number of the next heading, which has the given level; returns its depth
+    size_t next(int level, std::string& number);
+
+private:
+    std::vector<int> open;       // levels of the headings enclosing the last one
+    std::vector<size_t> counts;  // per depth: headings so far under the same parent
+};
+
+// Drop the spaces, tabs and newlines a heading's plain text ends with; both
+// the outline and --emit toc clean titles this way
+void trimTitle(std::string& title);
+
+// A heading and the part of the document below it
+struct Section {
+    size_t offset;       // start of the heading line
+    size_t end;          // start of the next heading of the same or a higher level, or the document end
+    int level;
+    size_t depth;        // 1 for top-level sections
+    std::string number;  // outline number, e.g. "3.2"
+    std::string title;   // heading text without inline markup
+};
+
+// Every heading of the document, indexing all of it first. Only heading
+// lines are parsed; everything else is passed over by the index scan.
+std::vector<Section> buildOutline(BlockIndex& index);
+
+// The section named by query: an outline number such as "3.2", or a title,
+// matched exactly and then ignoring ASCII case. A number no section has is
+// tried as a title, so "# 2024" is found by "2024". nullptr if there is none.
+const Section* findSection(const std::vector<Section>& outline, std::string_view query);
+
+// Indented "number title" lines, one per section
+void writeOutline(const std::vector<Section>& outline, std::string& out);
+
+} // namespace mdmni
+
+#endif // OUTLINE_H
@@ -0,0 +1,76 @@
+#include "OutputSink.h"
+
+namespace mdmni {
+
+OutputSink::OutputSink(size_t capacity_) : capacity(capacity_ ? capacity_ : DefaultCapacity), limit(capacity) {
+    own.reserve(capacity);
+}
+
+OutputSink::~OutputSink() {
+    flush();
+}
+
+void OutputSink::attach(std::ostream& o) {
+    if (out == &o) return;
+    detach();
+    out = &o;
+}
+
+void OutputSink::attach(std::string& s) {
+    detach();
+    buf = &s;
+    limit = std::string::npos;
+    attachedSize = s.size();
+}
+
+void OutputSink::detach() {
+    flush();
+    if (stats && buf != &own) stats->bytesOut += buf->size() - attachedSize;
+    out = nullptr;
+    buf = &own;
+    limit = capacity;
+}
+
+void OutputSink::discard() {
+    own.clear();
+    out = nullptr;
+    buf = &own;
+    limit = capacity;
+}
+
+void OutputSink::writeBuffered() {
+    // A caller's string is the final destination; there is nothing to write
+    if (buf != &own) return;
+    if (!buf->empty() && out) writeStream(buf->data(), buf->size());
+    buf->clear();
+}
+
+void OutputSink::writeStream(const char* data, size_t n) {
+    PhaseScope phase(stats, Phase::Write);
+    if (stats) {
+        stats->bytesOut += n;
+        stats->outputWrites++;
+    }
+    out->write(data, static_cast<std::streamsize>(n));
+}
+
+// Buffer is full: write it out, then keep the new data unless it alone
+// would fill the buffer, in which case it goes straight to the stream.
+void OutputSink::spill(const char* data, size_t n) {
+    writeBuffered();
+    if (n >= capacity) {
+        if (out) writeStream(data, n);
+    } else {
+        own.append(data, n);
+    }
+}
+
+void OutputSink::flush() {
+    writeBuffered();
+    if (out) {
+        PhaseScope phase(stats, Phase::Write);
+        out->flush();
+    }
+}
+
+} // namespace mdmni
@@ -0,0 +1,109 @@
+#ifndef OUTPUT_SINK_H
+#define OUTPUT_SINK_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include "RenderStats.h"
+
+namespace mdmni {
+
+// When buffered output is handed to the underlying stream
+enum class FlushPolicy {
+    Full,   // only when the buffer fills, or at the end of the document
+    Block,  // also once a finished block is waiting and no more input is ready
+    Line    // after every output line (interactive pipes)
+};
+
+// Large contiguous output buffer in front of a std::ostream. Rendering
+// appends into the buffer and the stream only sees one write per flush, so
+// the number of write(2) calls follows the output size rather than the line
+// count. Output can also go straight into a caller's string instead.
+class OutputSink {
+public:
+    static constexpr size_t DefaultCapacity = 64 * 1024;
+
+    explicit OutputSink(size_t capacity = DefaultCapacity);
+    ~OutputSink();
+
+    OutputSink(const OutputSink&) = delete;
+    OutputSink& operator=(const OutputSink&) = delete;
+
+    // Direct output to out, flushing anything pending for a previous stream
+    void attach(std::ostream& out);
+    // Append output directly to out, which then plays the role of the buffer
+    void attach(std::string& out);
+    // Flush and let go of the stream or string, which may then be destroyed
+    void detach();
+    // Drop buffered output and let go of the stream or string without writing
+    void discard();
+
+    void setPolicy(FlushPolicy p) { policy = p; }
+    // Count output bytes and writes, and time the writes, into s (or stop)
+    void setStats(RenderStats* s) { stats = StatsCompiled ? s : nullptr; }
+    FlushPolicy getPolicy() const { return policy; }
+
+    void append(const char* data, size_t n) {
+        if (buf->size() + n > limit) {
+            spill(data, n);
+            return;
+        }
+        buf->append(data, n);
+    }
+    void append(std::string_view s) { append(s.data(), s.size()); }
+    void put(char c) {
+        if (buf->size() + 1 > limit) writeBuffered();
+        buf->push_back(c);
+    }
+    void repeat(std::string_view s, size_t count) {
+        // Padding and rules: a single byte goes in with one append
+        if (s.size() == 1 && buf->size() + count <= limit) {
+            buf->append(count, s[0]);
+            return;
+        }
+        for (size_t i = 0; i < count; ++i) append(s);
+    }
+
+    // End the current output line
+    void newline() {
+        put('\n');
+        if (policy == FlushPolicy::Line) flush();
+    }
+
+    // The caller is about to wait for more input, so in Block mode any
+    // finished blocks must become visible now
+    void waitingForInput() {
+        if (policy == FlushPolicy::Block && out && !buf->empty()) flush();
+    }
+
+    // Hand all buffered bytes to the stream and flush it
+    void flush();
+
+    // True once the stream has refused output (e.g. the reader went away);
+    // further rendering is pointless
+    bool failed() const { return out && out->fail(); }
+
+    OutputSink& operator<<(std::string_view s) { append(s); return *this; }
+    OutputSink& operator<<(const std::string& s) { append(s.data(), s.size()); return *this; }
+    OutputSink& operator<<(const char* s) { append(std::string_view(s)); return *this; }
+    OutputSink& operator<<(char c) { put(c); return *this; }
+
+private:
+    std::ostream* out = nullptr;
+    std::string own;
+    std::string* buf = &own;  // own, or the caller's string
+    size_t capacity;
+    size_t limit;             // capacity, or unlimited for a caller's string
+    FlushPolicy policy = FlushPolicy::Full;
+    RenderStats* stats = nullptr;
+    size_t attachedSize = 0;  // size of the caller's string when attached
+
+    void writeBuffered();
+    void writeStream(const char* data, size_t n);
+    void spill(const char* data, size_t n);
+};
+
+} // namespace mdmni
+
+#endif // OUTPUT_SINK_H
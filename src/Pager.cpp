@@ -0,0 +1,456 @@
+#include "Pager.h"
+#include "FileWatch.h"
+#include "Hash.h"
+#include "InputSource.h"
+#include "TextWidth.h"
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cerrno>
+#include <cstdio>
+#include <sstream>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace mdmni {
+
+namespace {
+
+volatile std::sig_atomic_t resized = 0;
+
+void onResize(int) {
+    resized = 1;
+}
+
+// Puts the terminal into raw mode for the lifetime of the object
+class RawTerminal {
+public:
+    explicit RawTerminal(int fd_) : fd(fd_) {
+        if (tcgetattr(fd, &saved) != 0) return;
+        termios raw = saved;
+        raw.c_lflag &= static_cast<tcflag_t>(~(ICANON | ECHO | ISIG | IEXTEN));
+        raw.c_iflag &= static_cast<tcflag_t>(~(IXON | ICRNL));
+        raw.c_cc[VMIN] = 1;
+        raw.c_cc[VTIME] = 0;
+        active = tcsetattr(fd, TCSAFLUSH, &raw) == 0;
+    }
+    ~RawTerminal() {
+        if (active) tcsetattr(fd, TCSAFLUSH, &saved);
+    }
+    bool ok() const { return active; }
+
+private:
+    int fd;
+    termios saved{};
+    bool active = false;
+};
+
+void writeAll(int fd, const std::string& s) {
+    size_t done = 0;
+    while (done < s.size()) {
+        ssize_t n = ::write(fd, s.data() + done, s.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return;
+        done += static_cast<size_t>(n);
+    }
+}
+
+// Read a whole file into out; false if it cannot be opened or read
+bool readFile(const std::string& path, std::string& out) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st;
+    out.resize(fstat(fd, &st) == 0 && st.st_size > 0 ? static_cast<size_t>(st.st_size) : 0);
+    size_t got = 0;
+    ssize_t n;
+    for (;;) {
+        // The file may have grown since fstat()
+        if (got == out.size()) out.resize(out.size() + 64 * 1024);
+        n = ::read(fd, &out[got], out.size() - got);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        got += static_cast<size_t>(n);
+    }
+    ::close(fd);
+    out.resize(got);
+    return n == 0;
+}
+
+enum class Key { None, Quit, Down, Up, PageDown, PageUp, HalfDown, HalfUp, Home, End, NextHeading, PrevHeading };
+
+Key decodeKey(const char* b, ssize_t n) {
+    if (n <= 0) return Key::None;
+    if (b[0] == '\033') {
+        std::string_view seq(b + 1, static_cast<size_t>(n - 1));
+        if (seq == "[A" || seq == "OA") return Key::Up;
+        if (seq == "[B" || seq == "OB") return Key::Down;
+        if (seq == "[5~") return Key::PageUp;
+        if (seq == "[6~") return Key::PageDown;
+        if (seq == "[H" || seq == "OH" || seq == "[1~") return Key::Home;
+        if (seq == "[F" || seq == "OF" || seq == "[4~") return Key::End;
+        if (seq.empty()) return Key::Quit;
+        return Key::None;
+    }
+    switch (b[0]) {
+    case 'q': case 'Q': case 3: return Key::Quit;
+    case 'j': case '\r': case '\n': case 'e': return Key::Down;
+    case 'k': case 'y': return Key::Up;
+    case ' ': case 'f': case 6: return Key::PageDown;
+    case 'b': case 2: return Key::PageUp;
+    case 'd': case 4: return Key::HalfDown;
+    case 'u': case 21: return Key::HalfUp;
+    case 'g': case '<': return Key::Home;
+    case 'G': case '>': return Key::End;
+    case ']': return Key::NextHeading;
+    case '[': return Key::PrevHeading;
+    }
+    return Key::None;
+}
+
+} // namespace
+
+Pager::Pager(std::string_view doc, const RenderOptions& opts_, std::string title_)
+    : index(doc), opts(opts_), title(std::move(title_)) {}
+
+Pager::~Pager() = default;
+
+bool Pager::watch(const std::string& path) {
+    watcher = std::make_unique<FileWatch>(path);
+    if (!watcher->valid() || !readFile(path, texts[live])) {
+        watcher.reset();
+        return false;
+    }
+    watchPath = path;
+    index = BlockIndex(texts[live]);
+    cache.clear();
+    lru.clear();
+    top = Pos();
+    return true;
+}
+
+void Pager::reload() {
+    auto start = std::chrono::steady_clock::now();
+    // A file replaced by rename can be missing for a moment; the next event
+    // brings the new version
+    std::string& next = texts[1 - live];
+    if (!readFile(watchPath, next)) return;
+
+    size_t topOffset = index.checkpoint(top.seg).offset;
+    IndexEdit edit = index.update(next);
+    texts[live].clear();
+    live = 1 - live;
+
+    // Pages before and after the edit keep their text under their new
+    // segment numbers. Pages from inside it are reused for new segments
+    // with the same source and starting fence.
+    auto old = std::move(cache);
+    std::list<size_t> oldLru = std::move(lru);
+    cache.clear();
+    lru.clear();
+    std::vector<std::unique_ptr<Page>> spare;
+    for (size_t seg : oldLru) {
+        std::unique_ptr<Page> p = std::move(old[seg].first);
+        if (seg >= edit.first && seg < edit.first + edit.removed) {
+            spare.push_back(std::move(p));
+            continue;
+        }
+        size_t to = seg < edit.first ? seg : seg - edit.removed + edit.inserted;
+        lru.push_back(to);
+        cache.emplace(to, std::make_pair(std::move(p), std::prev(lru.end())));
+    }
+    for (size_t seg = edit.first; seg < edit.first + edit.inserted && !spare.empty(); ++seg) {
+        std::string_view text = index.segment(seg);
+        uint64_t hash = xxh64(text.data(), text.size());
+        for (auto it = spare.begin(); it != spare.end(); ++it) {
+            if ((*it)->hash != hash || !((*it)->fence == index.checkpoint(seg).fence)) continue;
+            lru.push_back(seg);
+            cache.emplace(seg, std::make_pair(std::move(*it), std::prev(lru.end())));
+            spare.erase(it);
+            break;
+        }
+    }
+
+    // Stay on the same part of the document
+    if (top.seg >= edit.first + edit.removed) {
+        top.seg = top.seg - edit.removed + edit.inserted;
+    } else if (top.seg >= edit.first) {
+        top.seg = index.segmentAt(std::min(topOffset, next.size()));
+        top.line = std::min(top.line, lineCount(top.seg));
+    }
+    down(0);
+
+    std::chrono::duration<double, std::milli> took = std::chrono::steady_clock::now() - start;
+    char buf[64];
+    std::snprintf(buf, sizeof buf, "[reloaded in %.1f ms]", took.count());
+    notice = buf;
+}
+
+const Pager::Page& Pager::page(size_t seg) {
+    auto it = cache.find(seg);
+    if (it != cache.end()) {
+        lru.splice(lru.begin(), lru, it->second.second);
+        return *it->second.first;
+    }
+
+    index.ensureSegment(seg);
+    auto p = std::make_unique<Page>();
+    p->hash = xxh64(index.segment(seg).data(), index.segment(seg).size());
+    p->fence = index.checkpoint(seg).fence;
+    {
+        MemoryInput in(index.segment(seg));
+        std::ostringstream buf;
+        Renderer r(opts);
+        r.restoreFence(index.checkpoint(seg).fence);
+        r.render(in, buf);
+        p->text = buf.str();
+    }
+    std::string_view text = p->text;
+    size_t start = 0;
+    while (start < text.size()) {
+        size_t nl = text.find('\n', start);
+        if (nl == std::string_view::npos) nl = text.size();
+        p->lines.push_back(text.substr(start, nl - start));
+        start = nl + 1;
+    }
+
+    if (cache.size() >= CacheSegments) {
+        cache.erase(lru.back());
+        lru.pop_back();
+    }
+    lru.push_front(seg);
+    const Page& ref = *p;
+    cache.emplace(seg, std::make_pair(std::move(p), lru.begin()));
+    return ref;
+}
+
+void Pager::down(size_t n) {
+    while (n > 0) {
+        size_t avail = lineCount(top.seg) - top.line;
+        if (n < avail) {
+            top.line += n;
+            break;
+        }
+        if (!index.ensureSegment(top.seg + 1)) {
+            top.line = lineCount(top.seg);
+            break;
+        }
+        n -= avail;
+        top.seg++;
+        top.line = 0;
+    }
+    // Never scroll past the point where the last line reaches the bottom
+    size_t visible = 0;
+    Pos p = top;
+    for (;;) {
+        visible += lineCount(p.seg) - p.line;
+        if (visible >= bodyRows() || !index.ensureSegment(p.seg + 1)) break;
+        p.seg++;
+        p.line = 0;
+    }
+    if (visible < bodyRows()) up(bodyRows() - visible);
+}
+
+void Pager::up(size_t n) {
+    while (n > 0) {
+        if (top.line >= n) {
+            top.line -= n;
+            break;
+        }
+        if (top.seg == 0) {
+            top.line = 0;
+            break;
+        }
+        n -= top.line;
+        top.seg--;
+        top.line = lineCount(top.seg);
+    }
+}
+
+void Pager::toEnd() {
+    index.extendAll();
+    top.seg = index.segmentsKnown() - 1;
+    top.line = lineCount(top.seg);
+    up(bodyRows());
+}
+
+void Pager::nextHeading() {
+    size_t here = index.checkpoint(top.seg).offset;
+    for (;;) {
+        const auto& hs = index.headings();
+        auto it = std::upper_bound(hs.begin(), hs.end(), here,
+                                   [](size_t off, const HeadingMark& h) { return off < h.offset; });
+        if (it != hs.end()) {
+            top.seg = index.segmentAt(it->offset);
+            top.line = 0;
+            down(0);
+            return;
+        }
+        if (index.complete()) return;
+        index.extendTo(index.segmentsKnown() + 64);
+    }
+}
+
+void Pager::prevHeading() {
+    size_t here = index.checkpoint(top.seg).offset;
+    const auto& hs = index.headings();
+    // Headings in the current segment count only once it has been scrolled into
+    auto it = top.line > 0
+        ? std::upper_bound(hs.begin(), hs.end(), here, [](size_t off, const HeadingMark& h) { return off < h.offset; })
+        : std::lower_bound(hs.begin(), hs.end(), here, [](const HeadingMark& h, size_t off) { return h.offset < off; });
+    if (it == hs.begin()) {
+        top = Pos();
+        return;
+    }
+    --it;
+    top.seg = index.segmentAt(it->offset);
+    top.line = 0;
+}
+
+void Pager::updateSize() {
+    winsize ws{};
+    if (ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_row > 0) {
+        rows = ws.ws_row;
+        cols = ws.ws_col;
+    }
+    if (!autoWrap || cols <= 0 || opts.wrap == cols) return;
+    // Render everything again at the new width, keeping the top of the
+    // screen at about the same place in its segment
+    size_t before = cache.empty() ? 0 : lineCount(top.seg);
+    opts.wrap = cols;
+    cache.clear();
+    lru.clear();
+    if (before) top.line = top.line * lineCount(top.seg) / before;
+    down(0);
+}
+
+void Pager::draw() {
+    std::vector<std::string> screen;
+    screen.reserve(static_cast<size_t>(rows));
+    Pos p = top;
+    bool atEnd = false;
+    while (screen.size() < bodyRows()) {
+        const Page& pg = page(p.seg);
+        for (; p.line < pg.lines.size() && screen.size() < bodyRows(); ++p.line)
+            screen.emplace_back(pg.lines[p.line]);
+        if (screen.size() >= bodyRows()) break;
+        if (!index.ensureSegment(p.seg + 1)) {
+            atEnd = true;
+            break;
+        }
+        p.seg++;
+        p.line = 0;
+    }
+    while (screen.size() < bodyRows()) screen.emplace_back("~");
+    // One segment of look-ahead so the next page-down is already rendered
+    if (!atEnd && index.ensureSegment(p.seg + 1)) page(p.seg + 1);
+    if (!atEnd) atEnd = p.line >= lineCount(p.seg) && !index.ensureSegment(p.seg + 1);
+
+    std::string status = " " + title + " ";
+    size_t size = index.document().size();
+    if (atEnd) status += "(END)";
+    else if (size) status += std::to_string(index.checkpoint(top.seg).offset * 100 / size) + "%";
+    if (!notice.empty()) status += "  " + notice;
+    // Cut at the terminal's width without splitting a character
+    size_t used = 0;
+    size_t end = 0;
+    while (end < status.size()) {
+        size_t len;
+        size_t w = static_cast<size_t>(charWidth(status, end, len));
+        if (used + w > static_cast<size_t>(cols)) break;
+        used += w;
+        end += len;
+    }
+    status.resize(end);
+    screen.push_back("\033[7m" + status);
+
+    // Only rows that differ from what is on screen are sent
+    if (shown.size() != screen.size()) shown.assign(screen.size(), std::string(1, '\0'));
+    std::string out;
+    for (size_t r = 0; r < screen.size(); ++r) {
+        if (screen[r] == shown[r]) continue;
+        out += "\033[" + std::to_string(r + 1) + ";1H";
+        out += screen[r];
+        out += "\033[0m\033[K";
+    }
+    writeAll(STDOUT_FILENO, out);
+    shown.swap(screen);
+}
+
+bool Pager::run() {
+    if (!isatty(STDOUT_FILENO)) return false;
+    int tty = ::open("/dev/tty", O_RDONLY | O_CLOEXEC);
+    if (tty < 0) return false;
+
+    {
+        RawTerminal raw(tty);
+        if (!raw.ok()) {
+            ::close(tty);
+            return false;
+        }
+        struct sigaction sa{};
+        sa.sa_handler = onResize;
+        sigemptyset(&sa.sa_mask);
+        struct sigaction oldSa{};
+        sigaction(SIGWINCH, &sa, &oldSa);
+
+        // Alternate screen, hidden cursor, no autowrap (long lines are clipped)
+        writeAll(STDOUT_FILENO, "\033[?1049h\033[?25l\033[?7l\033[2J");
+        updateSize();
+        draw();
+
+        for (;;) {
+            pollfd fds[2] = { { tty, POLLIN, 0 }, { watcher ? watcher->descriptor() : -1, POLLIN, 0 } };
+            ssize_t n = poll(fds, 2, -1);
+            char buf[16];
+            if (n > 0 && (fds[1].revents & POLLIN)) {
+                if (watcher->changed()) {
+                    reload();
+                    draw();
+                }
+                if (!(fds[0].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            }
+            if (n > 0) n = ::read(tty, buf, sizeof buf);
+            if (n < 0 && errno == EINTR) {
+                if (resized) {
+                    resized = 0;
+                    updateSize();
+                    writeAll(STDOUT_FILENO, "\033[2J");
+                    shown.clear();
+                    draw();
+                }
+                continue;
+            }
+            if (n <= 0) break;
+
+            size_t pageRows = bodyRows() > 1 ? bodyRows() - 1 : 1;
+            Key k = decodeKey(buf, n);
+            if (k == Key::Quit) break;
+            switch (k) {
+            case Key::Down: down(1); break;
+            case Key::Up: up(1); break;
+            case Key::PageDown: down(pageRows); break;
+            case Key::PageUp: up(pageRows); break;
+            case Key::HalfDown: down(bodyRows() / 2); break;
+            case Key::HalfUp: up(bodyRows() / 2); break;
+            case Key::Home: top = Pos(); break;
+            case Key::End: toEnd(); break;
+            case Key::NextHeading: nextHeading(); break;
+            case Key::PrevHeading: prevHeading(); break;
+            default: continue;
+            }
+            notice.clear();
+            draw();
+        }
+
+        writeAll(STDOUT_FILENO, "\033[?7h\033[?25h\033[?1049l");
+        sigaction(SIGWINCH, &oldSa, nullptr);
+    }
+    ::close(tty);
+    return true;
+}
+
+} // namespace mdmni
@@ -0,0 +1,94 @@
+#ifndef PAGER_H
+#define PAGER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "BlockIndex.h"
+#include "Renderer.h"
+
+namespace mdmni {
+
+class FileWatch;
+
+// Built-in terminal pager that renders lazily. Only the segments of the
+// BlockIndex that are on screen, plus one segment of look-ahead, are
+// rendered; rendered segments are kept in a small LRU cache so scrolling
+// back and forth does not render them again.
+class Pager {
+public:
+    static constexpr size_t CacheSegments = 128;
+
+    Pager(std::string_view doc, const RenderOptions& opts, std::string title);
+    ~Pager();
+
+    // Show the file at path instead of doc and follow it as it is saved.
+    // Each save re-indexes only the edited part, keeps rendered segments
+    // before and after it, and redraws the rows that changed. Returns false
+    // if the file cannot be read or watched.
+    bool watch(const std::string& path);
+
+    // Wrap at the terminal's width, and at the new width when the window is
+    // resized; for when no width was asked for
+    void wrapToTerminal() { autoWrap = true; }
+
+    // Run the interactive loop on the controlling terminal. Returns false
+    // if stdout is not a terminal, in which case nothing has been drawn.
+    bool run();
+
+private:
+    struct Page {
+        std::string text;
+        std::vector<std::string_view> lines;
+        uint64_t hash;      // of the segment's source
+        FenceState fence;   // at the segment's start
+    };
+    struct Pos {
+        size_t seg = 0;
+        size_t line = 0;
+    };
+
+    BlockIndex index;
+    RenderOptions opts;
+    std::string title;
+
+    std::list<size_t> lru;  // most recently used first
+    std::unordered_map<size_t, std::pair<std::unique_ptr<Page>, std::list<size_t>::iterator>> cache;
+
+    Pos top;
+    int rows = 24;
+    int cols = 80;
+    std::vector<std::string> shown;  // screen rows as last drawn
+    bool autoWrap = false;
+
+    // Watch mode: the file is read into one text while the other holds the
+    // version on screen
+    std::unique_ptr<FileWatch> watcher;
+    std::string watchPath;
+    std::string texts[2];
+    int live = 0;
+    std::string notice;  // shown in the status line until the next key
+
+    const Page& page(size_t seg);
+    size_t lineCount(size_t seg) { return page(seg).lines.size(); }
+
+    void down(size_t n);
+    void up(size_t n);
+    void toEnd();
+    void nextHeading();
+    void prevHeading();
+    size_t bodyRows() const { return rows > 1 ? static_cast<size_t>(rows - 1) : 1; }
+
+    void updateSize();
+    void draw();
+    void reload();
+};
+
+} // namespace mdmni
+
+#endif // PAGER_H
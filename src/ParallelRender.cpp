@@ -0,0 +1,119 @@
+#include "ParallelRender.h"
+#include "InputSource.h"
+#include "BlockIndex.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace mdmni {
+
+// Merge consecutive index segments into chunks of at least targetBytes
+std::vector<DocumentChunk> splitDocument(std::string_view doc, size_t targetBytes) {
+    BlockIndex index(doc, targetBytes);
+    index.extendAll();
+    std::vector<DocumentChunk> chunks;
+    size_t n = index.segmentsKnown();
+    size_t first = 0;
+    for (size_t i = 0; i < n; ++i) {
+        size_t begin = index.checkpoint(first).offset;
+        size_t end = i + 1 < n ? index.checkpoint(i + 1).offset : doc.size();
+        if (end - begin >= targetBytes || i + 1 == n) {
+            chunks.push_back(DocumentChunk{doc.substr(begin, end - begin), index.checkpoint(first).fence});
+            first = i + 1;
+        }
+    }
+    return chunks;
+}
+
+void renderParallel(std::string_view doc, std::ostream& out, const RenderOptions& opts, unsigned jobs,
+                    RenderStats* stats) {
+    if (jobs == 0) jobs = 1;
+    // Several chunks per worker keeps threads busy when chunk costs differ
+    size_t target = std::clamp<size_t>(doc.size() / (jobs * 8), 64 * 1024, 4 * 1024 * 1024);
+    std::vector<DocumentChunk> chunks = splitDocument(doc, target);
+
+    if (jobs == 1 || chunks.size() < 2) {
+        MemoryInput in(doc);
+        Renderer r(opts);
+        r.setStats(stats);
+        r.render(in, out);
+        return;
+    }
+
+    // Rendered chunks wait here until every earlier chunk has been written;
+    // the window caps how far workers may run ahead of the writer.
+    struct Slot {
+        std::string text;
+        bool done = false;
+    };
+    std::vector<Slot> slots(chunks.size());
+    const size_t window = static_cast<size_t>(jobs) * 4;
+    std::mutex m;
+    std::condition_variable cv;
+    size_t nextToClaim = 0;
+    size_t nextToWrite = 0;
+
+    auto worker = [&]() {
+        for (;;) {
+            size_t i;
+            {
+                std::unique_lock<std::mutex> lock(m);
+                cv.wait(lock, [&] { return nextToClaim >= chunks.size() || nextToClaim < nextToWrite + window; });
+                if (nextToClaim >= chunks.size()) return;
+                i = nextToClaim++;
+            }
+            std::string text;
+            RenderStats chunkStats;
+            Renderer r(opts);
+            if (stats) r.setStats(&chunkStats);
+            r.restoreFence(chunks[i].fence);
+            r.render(chunks[i].text, text);
+            {
+                std::lock_guard<std::mutex> lock(m);
+                slots[i].text.swap(text);
+                slots[i].done = true;
+                if (stats) stats->merge(chunkStats);
+            }
+            cv.notify_all();
+        }
+    };
+
+    unsigned threads = static_cast<unsigned>(std::min<size_t>(jobs, chunks.size()));
+    std::vector<std::thread> pool;
+    pool.reserve(threads);
+    for (unsigned t = 0; t < threads; ++t) pool.emplace_back(worker);
+
+    for (size_t i = 0; i < slots.size(); ++i) {
+        std::string text;
+        {
+            std::unique_lock<std::mutex> lock(m);
+            cv.wait(lock, [&] { return slots[i].done; });
+            text.swap(slots[i].text);
+        }
+        auto writeStart = std::chrono::steady_clock::now();
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
+        bool failed = !out;
+        {
+            std::lock_guard<std::mutex> lock(m);
+            if (stats) {
+                stats->phaseNanos[static_cast<size_t>(Phase::Write)] += static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - writeStart).count());
+                stats->outputWrites++;
+            }
+            ++nextToWrite;
+            // The reader went away: let workers finish what they hold and stop
+            if (failed) nextToClaim = chunks.size();
+        }
+        cv.notify_all();
+        if (failed) break;
+    }
+    out.flush();
+
+    for (auto& t : pool) t.join();
+}
+
+} // namespace mdmni
@@ -0,0 +1,33 @@
+#ifndef PARALLEL_RENDER_H
+#define PARALLEL_RENDER_H
+
+#include <cstddef>
+#include <ostream>
+#include <string_view>
+#include <vector>
+#include "Renderer.h"
+
+namespace mdmni {
+
+// A piece of a document that a fresh Renderer, given fence, renders exactly
+// as it would appear in the output of the whole document
+struct DocumentChunk {
+    std::string_view text;
+    FenceState fence;
+};
+
+// Cut doc at BlockIndex checkpoints into chunks of at least targetBytes
+// (the last one may be shorter)
+std::vector<DocumentChunk> splitDocument(std::string_view doc, size_t targetBytes);
+
+// Render doc on up to jobs threads, writing the result to out in document
+// order. The document is cut at BlockIndex checkpoints into chunks that
+// fresh Renderers can take up independently, so output is byte-identical to
+// rendering the whole document with a single Renderer. Statistics of all
+// workers are added to stats when given; phase times are summed over threads.
+void renderParallel(std::string_view doc, std::ostream& out, const RenderOptions& opts, unsigned jobs,
+                    RenderStats* stats = nullptr);
+
+} // namespace mdmni
+
+#endif // PARALLEL_RENDER_H
@@ -0,0 +1,33 @@
+#include "PlainWriter.h"
+
+namespace mdmni {
+
+void PlainWriter::beginBlock(const Block& b) {
+    if (b.kind == BlockKind::TableRow) {
+        separatorRow = b.separator;
+        firstCell = true;
+    } else if (b.kind == BlockKind::TableCell && !separatorRow) {
+        if (!firstCell) sink << '\t';
+        firstCell = false;
+    }
+}
+
+void PlainWriter::endBlock(const Block& b) {
+    switch (b.kind) {
+    case BlockKind::Paragraph:
+    case BlockKind::Heading:
+    case BlockKind::Quote:
+    case BlockKind::ListItem:
+        sink.newline();
+        return;
+    case BlockKind::TableRow:
+        if (!separatorRow) sink.newline();
+        return;
+    case BlockKind::CodeBlock:
+    case BlockKind::Table:
+    case BlockKind::TableCell:
+        return;
+    }
+}
+
+} // namespace mdmni
@@ -0,0 +1,38 @@
+#ifndef PLAIN_WRITER_H
+#define PLAIN_WRITER_H
+
+#include <string_view>
+#include "DocumentEvents.h"
+#include "OutputSink.h"
+
+namespace mdmni {
+
+// Unstyled text for search indexing: one line per paragraph, heading, quote
+// or list item, table rows with their cells separated by tabs, and code
+// lines as they are. Markers, URLs, rules and blank lines are dropped.
+class PlainWriter final : public DocumentHandler {
+public:
+    OutputSink& output() { return sink; }
+
+    void beginBlock(const Block& b) override;
+    void endBlock(const Block& b) override;
+    void text(std::string_view s) override { sink << s; }
+    void beginSpan(InlineSpan, std::string_view) override {}
+    void endSpan(InlineSpan, std::string_view) override {}
+    void codeLine(std::string_view line) override {
+        sink << line;
+        sink.newline();
+    }
+    void rule() override {}
+    void blankLine() override {}
+    void endDocument() override { sink.detach(); }
+
+private:
+    OutputSink sink;
+    bool separatorRow = false;
+    bool firstCell = false;
+};
+
+} // namespace mdmni
+
+#endif // PLAIN_WRITER_H
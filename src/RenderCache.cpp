@@ -0,0 +1,205 @@
+#include "RenderCache.h"
+#include "Hash.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace mdmni {
+
+//
+// TeeStreamBuf
+//
+
+std::streamsize TeeStreamBuf::xsputn(const char* s, std::streamsize n) {
+    if (copy) copy.write(s, n);
+    primary.write(s, n);
+    return primary ? n : 0;
+}
+
+TeeStreamBuf::int_type TeeStreamBuf::overflow(int_type c) {
+    if (traits_type::eq_int_type(c, traits_type::eof())) return traits_type::not_eof(c);
+    char ch = traits_type::to_char_type(c);
+    return xsputn(&ch, 1) == 1 ? c : traits_type::eof();
+}
+
+int TeeStreamBuf::sync() {
+    if (copy) copy.flush();
+    primary.flush();
+    return primary ? 0 : -1;
+}
+
+namespace {
+
+bool mkdirs(const std::string& path) {
+    if (path.empty()) return false;
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0) return S_ISDIR(st.st_mode);
+    size_t slash = path.find_last_of('/');
+    if (slash != std::string::npos && slash > 0 && !mkdirs(path.substr(0, slash))) return false;
+    return mkdir(path.c_str(), 0700) == 0 || errno == EEXIST;
+}
+
+// Fallback for descriptors sendfile() cannot write to. False on any read or
+// write error, or if in ends before size bytes.
+bool copyFd(int in, int out, size_t size) {
+    char buf[64 * 1024];
+    size_t sent = 0;
+    while (sent < size) {
+        ssize_t n = ::read(in, buf, sizeof buf);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        ssize_t off = 0;
+        while (off < n) {
+            ssize_t w = ::write(out, buf + off, static_cast<size_t>(n - off));
+            if (w < 0 && errno == EINTR) continue;
+            if (w <= 0) return false;
+            off += w;
+        }
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+} // namespace
+
+//
+// RenderCache
+//
+
+std::string RenderCache::defaultDirectory() {
+    const char* xdg = std::getenv("XDG_CACHE_HOME");
+    if (xdg && xdg[0] == '/') return std::string(xdg) + "/mdmni";
+    const char* home = std::getenv("HOME");
+    if (home && home[0]) return std::string(home) + "/.cache/mdmni";
+    return std::string();
+}
+
+RenderCache::RenderCache(std::string dir_, uint64_t maxBytes_) : dir(std::move(dir_)), maxBytes(maxBytes_) {}
+
+std::string RenderCache::key(std::string_view doc, const RenderOptions& opts) {
+    char name[160];
+    std::snprintf(name, sizeof name, "%016llx-%llx-c%du%dw%dt%zu-r%u",
+                  static_cast<unsigned long long>(xxh64(doc.data(), doc.size(), 0)),
+                  static_cast<unsigned long long>(doc.size()),
+                  opts.useColor ? 1 : 0, opts.showUrls ? 1 : 0, opts.wrap, opts.tableRowLimit,
+                  RendererVersion);
+    return name;
+}
+
+bool RenderCache::ensureDirectory() {
+    return mkdirs(dir);
+}
+
+bool RenderCache::serve(const std::string& key, int outFd) {
+    if (dir.empty()) return false;
+    int fd = ::open((dir + "/" + key).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return false;
+    }
+    // Mark as recently used for eviction
+    futimens(fd, nullptr);
+
+    size_t size = static_cast<size_t>(st.st_size);
+    off_t offset = 0;
+    bool ok = true;
+    while (static_cast<size_t>(offset) < size) {
+        ssize_t n = sendfile(outFd, fd, &offset, size - static_cast<size_t>(offset));
+        if (n > 0) continue;
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EINVAL || errno == ENOSYS) && offset == 0) {
+            ok = copyFd(fd, outFd, size);
+            // An entry that cannot be read back whole is not served again
+            if (!ok) unlink((dir + "/" + key).c_str());
+        } else {
+            // The reader went away part way through; the hit is still served
+            ok = offset > 0;
+        }
+        break;
+    }
+    ::close(fd);
+    return ok;
+}
+
+std::unique_ptr<RenderCache::Entry> RenderCache::store(const std::string& key) {
+    if (dir.empty() || !ensureDirectory()) return nullptr;
+    std::string tmp = dir + "/tmp.XXXXXX";
+    int fd = mkstemp(tmp.data());
+    if (fd < 0) return nullptr;
+    return std::make_unique<Entry>(*this, dir + "/" + key, tmp, fd);
+}
+
+void RenderCache::evict() {
+    DIR* d = opendir(dir.c_str());
+    if (!d) return;
+    struct File {
+        std::string path;
+        time_t mtime;
+        uint64_t size;
+    };
+    std::vector<File> files;
+    uint64_t total = 0;
+    time_t now = std::time(nullptr);
+    while (dirent* e = readdir(d)) {
+        if (e->d_name[0] == '.') continue;
+        std::string path = dir + "/" + e->d_name;
+        struct stat st;
+        if (stat(path.c_str(), &st) != 0 || !S_ISREG(st.st_mode)) continue;
+        // Temporary files of crashed runs
+        if (std::strncmp(e->d_name, "tmp.", 4) == 0) {
+            if (now - st.st_mtime > 3600) unlink(path.c_str());
+            continue;
+        }
+        files.push_back(File{path, st.st_mtime, static_cast<uint64_t>(st.st_size)});
+        total += static_cast<uint64_t>(st.st_size);
+    }
+    closedir(d);
+    if (total <= maxBytes) return;
+
+    std::sort(files.begin(), files.end(), [](const File& a, const File& b) { return a.mtime < b.mtime; });
+    for (const auto& f : files) {
+        if (total <= maxBytes) break;
+        if (unlink(f.path.c_str()) == 0) total -= f.size;
+    }
+}
+
+//
+// RenderCache::Entry
+//
+
+RenderCache::Entry::Entry(RenderCache& cache_, std::string path_, std::string tmpPath_, int fd_)
+    : cache(cache_), path(std::move(path_)), tmpPath(std::move(tmpPath_)), fd(fd_), out(fd_) {}
+
+RenderCache::Entry::~Entry() {
+    if (done) return;
+    ::close(fd);
+    unlink(tmpPath.c_str());
+}
+
+bool RenderCache::Entry::commit() {
+    if (done) return false;
+    done = true;
+    out.flush();
+    bool ok = static_cast<bool>(out);
+    ok = ::close(fd) == 0 && ok;
+    if (ok) ok = rename(tmpPath.c_str(), path.c_str()) == 0;
+    if (!ok) {
+        unlink(tmpPath.c_str());
+        return false;
+    }
+    cache.evict();
+    return true;
+}
+
+} // namespace mdmni
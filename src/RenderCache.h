@@ -0,0 +1,92 @@
+#ifndef RENDER_CACHE_H
+#define RENDER_CACHE_H
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include "FdStream.h"
+#include "Renderer.h"
+
+namespace mdmni {
+
+// Writes everything to a primary stream and a copy stream. A failing copy
+// is dropped quietly; a failing primary fails the tee, so rendering stops
+// when the reader goes away.
+class TeeStreamBuf : public std::streambuf {
+public:
+    TeeStreamBuf(std::ostream& primary, std::ostream& copy) : primary(primary), copy(copy) {}
+
+protected:
+    std::streamsize xsputn(const char* s, std::streamsize n) override;
+    int_type overflow(int_type c) override;
+    int sync() override;
+
+private:
+    std::ostream& primary;
+    std::ostream& copy;
+};
+
+class TeeOStream : public std::ostream {
+public:
+    TeeOStream(std::ostream& primary, std::ostream& copy) : std::ostream(nullptr), buf(primary, copy) { rdbuf(&buf); }
+
+private:
+    TeeStreamBuf buf;
+};
+
+// On-disk cache of rendered documents keyed by a hash of the input bytes and
+// of everything that affects output. Entries are written to a temporary
+// file and renamed into place, so concurrent invocations never see a
+// partial entry. The least recently used entries are evicted once the
+// directory grows past maxBytes.
+class RenderCache {
+public:
+    static constexpr uint64_t DefaultMaxBytes = 256ull * 1024 * 1024;
+
+    // A new entry being written; discarded unless commit() succeeds
+    class Entry {
+    public:
+        Entry(RenderCache& cache, std::string path, std::string tmpPath, int fd);
+        ~Entry();
+        Entry(const Entry&) = delete;
+        Entry& operator=(const Entry&) = delete;
+
+        std::ostream& stream() { return out; }
+        bool commit();
+
+    private:
+        RenderCache& cache;
+        std::string path;
+        std::string tmpPath;
+        int fd;
+        FdOStream out;
+        bool done = false;
+    };
+
+    // $XDG_CACHE_HOME/mdmni, falling back to ~/.cache/mdmni; empty if neither is known
+    static std::string defaultDirectory();
+
+    explicit RenderCache(std::string dir, uint64_t maxBytes = DefaultMaxBytes);
+
+    // Cache key for doc rendered with opts by this renderer version
+    static std::string key(std::string_view doc, const RenderOptions& opts);
+
+    // Copy a cached rendering to fd. False on a miss, or if nothing could be sent.
+    bool serve(const std::string& key, int fd);
+    // Start a new entry; nullptr if the cache directory is not writable
+    std::unique_ptr<Entry> store(const std::string& key);
+
+private:
+    std::string dir;
+    uint64_t maxBytes;
+
+    bool ensureDirectory();
+    void evict();
+};
+
+} // namespace mdmni
+
+#endif // RENDER_CACHE_H
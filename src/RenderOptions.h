@@ -0,0 +1,20 @@
+#ifndef RENDER_OPTIONS_H
+#define RENDER_OPTIONS_H
+
+#include <cstddef>
+
+namespace mdmni {
+
+// Everything that affects rendered output
+struct RenderOptions {
+    bool useColor = true;
+    bool showUrls = true;
+    int wrap = 0;
+    // 0 buffers whole tables. Otherwise column widths are fixed after this
+    // many rows and later rows stream out, with over-wide cells clipped.
+    size_t tableRowLimit = 0;
+};
+
+} // namespace mdmni
+
+#endif // RENDER_OPTIONS_H
@@ -0,0 +1,476 @@
+#include "RenderServer.h"
+#include "Renderer.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace mdmni {
+
+namespace {
+
+// Renderers kept warm per worker; the least recently used one is replaced
+constexpr size_t WarmRenderers = 8;
+// Buffers above this are given back once their request is answered
+constexpr size_t KeptBufferBytes = 1 << 20;
+constexpr size_t ReadChunk = 64 * 1024;
+
+uint32_t getU32(const char* p) {
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(p);
+    return uint32_t(b[0]) | uint32_t(b[1]) << 8 | uint32_t(b[2]) << 16 | uint32_t(b[3]) << 24;
+}
+
+void putU32(char* p, uint32_t v) {
+    p[0] = static_cast<char>(v);
+    p[1] = static_cast<char>(v >> 8);
+    p[2] = static_cast<char>(v >> 16);
+    p[3] = static_cast<char>(v >> 24);
+}
+
+// Replace out with a response carrying body
+void setResponse(std::string& out, uint32_t status, std::string_view body) {
+    out.assign(ServeResponseHeaderBytes, '\0');
+    putU32(&out[0], status);
+    putU32(&out[4], static_cast<uint32_t>(body.size()));
+    out.append(body.data(), body.size());
+}
+
+bool sameOptions(const RenderOptions& a, const RenderOptions& b) {
+    return a.useColor == b.useColor && a.showUrls == b.showUrls && a.wrap == b.wrap &&
+           a.tableRowLimit == b.tableRowLimit;
+}
+
+bool socketAddress(const std::string& path, sockaddr_un& addr) {
+    addr = sockaddr_un{};
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof addr.sun_path) {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    std::memcpy(addr.sun_path, path.data(), path.size());
+    return true;
+}
+
+} // namespace
+
+struct RenderServer::Connection {
+    int fd;
+    std::string in;         // unanswered requests, starting with the current one
+    std::string out;        // response being written
+    size_t written = 0;
+    uint32_t events = 0;    // what epoll watches for
+    bool busy = false;      // a worker is rendering the current request
+    bool closing = false;   // close once the response is written
+    bool hungUp = false;    // the peer went away while busy
+    RenderOptions opts;
+    std::string_view doc;
+
+    explicit Connection(int fd) : fd(fd) {}
+};
+
+RenderServer::RenderServer(unsigned workers) : workerCount(workers ? workers : 1) {}
+
+RenderServer::~RenderServer() {
+    for (std::unique_ptr<Connection>& c : connections)
+        if (c) ::close(c->fd);
+    if (listenFd >= 0) ::close(listenFd);
+    if (epollFd >= 0) ::close(epollFd);
+    if (wakeFd >= 0) ::close(wakeFd);
+}
+
+bool RenderServer::listen(const std::string& socketPath) {
+    sockaddr_un addr;
+    if (!socketAddress(socketPath, addr)) return false;
+    listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listenFd < 0) return false;
+    if (bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0) {
+        if (errno != EADDRINUSE) return false;
+        // Only a socket nobody answers on is taken over
+        int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (probe < 0) return false;
+        bool live = ::connect(probe, reinterpret_cast<sockaddr*>(&addr), sizeof addr) == 0 || errno != ECONNREFUSED;
+        ::close(probe);
+        if (live) {
+            errno = EADDRINUSE;
+            return false;
+        }
+        unlink(socketPath.c_str());
+        if (bind(listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0) return false;
+    }
+    path = socketPath;
+    if (::listen(listenFd, SOMAXCONN) < 0) return false;
+
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) return false;
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wakeFd < 0) return false;
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = listenFd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev) < 0) return false;
+    ev.data.fd = wakeFd;
+    return epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev) == 0;
+}
+
+void RenderServer::stop() {
+    stopping.store(true);
+    uint64_t one = 1;
+    ssize_t n = write(wakeFd, &one, sizeof one);
+    (void)n;
+}
+
+bool RenderServer::run() {
+    for (unsigned i = 0; i < workerCount; ++i) workers.emplace_back([this] { work(); });
+
+    bool ok = true;
+    epoll_event events[64];
+    while (!stopping.load()) {
+        int n = epoll_wait(epollFd, events, 64, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            ok = false;
+            break;
+        }
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == listenFd) {
+                accept();
+                continue;
+            }
+            if (fd == wakeFd) {
+                uint64_t count;
+                ssize_t r = read(wakeFd, &count, sizeof count);
+                (void)r;
+                finishRequests();
+                continue;
+            }
+            // A connection closed earlier in this batch may already be gone
+            if (static_cast<size_t>(fd) >= connections.size() || !connections[fd]) continue;
+            Connection& c = *connections[fd];
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                close(c);
+            } else if (events[i].events & EPOLLOUT) {
+                writeTo(c);
+            } else if (events[i].events & EPOLLIN) {
+                readFrom(c);
+            }
+        }
+    }
+    int saved = errno;
+
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        shutdown = true;
+    }
+    queued.notify_all();
+    for (std::thread& t : workers) t.join();
+    workers.clear();
+    for (std::unique_ptr<Connection>& c : connections)
+        if (c) {
+            ::close(c->fd);
+            c.reset();
+        }
+    if (!path.empty()) unlink(path.c_str());
+    errno = saved;
+    return ok;
+}
+
+void RenderServer::accept() {
+    for (;;) {
+        int fd = accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            // EAGAIN once the backlog is empty; out of descriptors, the
+            // client waits in the backlog until a connection closes
+            return;
+        }
+        if (static_cast<size_t>(fd) >= connections.size()) connections.resize(fd + 1);
+        connections[fd] = std::make_unique<Connection>(fd);
+        Connection& c = *connections[fd];
+        epoll_event ev{};
+        ev.events = EPOLLIN;
+        ev.data.fd = fd;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            close(c);
+            continue;
+        }
+        c.events = EPOLLIN;
+    }
+}
+
+void RenderServer::readFrom(Connection& c) {
+    for (;;) {
+        // The buffer grows with what arrives, never ahead of it
+        size_t room = std::min(ReadChunk, ServeMaxBufferedBytes - bufferedInput);
+        if (room == 0) {
+            reply(c, ServeFailed, "server busy");
+            writeTo(c);
+            return;
+        }
+        size_t have = c.in.size();
+        c.in.resize(have + room);
+        ssize_t n = recv(c.fd, &c.in[have], room, 0);
+        c.in.resize(have + (n > 0 ? static_cast<size_t>(n) : 0));
+        if (n > 0) {
+            bufferedInput += static_cast<size_t>(n);
+            dispatch(c);
+            // Stop once a request is complete; the rest waits in the socket
+            if (c.busy) return;
+            if (c.closing) {
+                writeTo(c);
+                return;
+            }
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return;
+        close(c);
+        return;
+    }
+}
+
+// Hand the first request in c.in to a worker once all of it has arrived
+void RenderServer::dispatch(Connection& c) {
+    if (c.in.size() < ServeRequestHeaderBytes) return;
+    uint32_t length = getU32(c.in.data());
+    uint32_t flags = getU32(c.in.data() + 4);
+    if (length > ServeMaxDocumentBytes) {
+        reply(c, ServeFailed, "document too large");
+        return;
+    }
+    if (flags & ~(ServeColor | ServeUrls)) {
+        reply(c, ServeFailed, "unknown request flags");
+        return;
+    }
+    if (c.in.size() < ServeRequestHeaderBytes + length) return;
+    c.opts.useColor = flags & ServeColor;
+    c.opts.showUrls = flags & ServeUrls;
+    c.opts.wrap = static_cast<int>(getU32(c.in.data() + 8));
+    c.opts.tableRowLimit = getU32(c.in.data() + 12);
+    c.doc = std::string_view(c.in).substr(ServeRequestHeaderBytes, length);
+    c.busy = true;
+    watch(c, 0);
+    {
+        std::lock_guard<std::mutex> lock(queueMutex);
+        pending.push_back(&c);
+    }
+    queued.notify_one();
+}
+
+// Queue an error response; the rest of the stream cannot be trusted after
+// it, so the connection closes once it is written
+void RenderServer::reply(Connection& c, uint32_t status, std::string_view message) {
+    setResponse(c.out, status, message);
+    c.closing = true;
+}
+
+void RenderServer::work() {
+    struct Warm {
+        RenderOptions opts;
+        std::unique_ptr<Renderer> renderer;
+        uint64_t lastUse;
+    };
+    std::vector<Warm> warm;
+    uint64_t uses = 0;
+    for (;;) {
+        Connection* c;
+        {
+            std::unique_lock<std::mutex> lock(queueMutex);
+            queued.wait(lock, [this] { return shutdown || !pending.empty(); });
+            if (pending.empty()) return;
+            c = pending.front();
+            pending.pop_front();
+        }
+
+        Warm* w = nullptr;
+        for (Warm& candidate : warm)
+            if (sameOptions(candidate.opts, c->opts)) w = &candidate;
+        if (!w) {
+            if (warm.size() < WarmRenderers) {
+                warm.push_back(Warm{c->opts, nullptr, 0});
+                w = &warm.back();
+            } else {
+                w = &warm[0];
+                for (Warm& candidate : warm)
+                    if (candidate.lastUse < w->lastUse) w = &candidate;
+                w->opts = c->opts;
+            }
+            w->renderer = std::make_unique<Renderer>(c->opts);
+        }
+        w->lastUse = ++uses;
+
+        // Render straight into the response, after room for its header
+        c->out.assign(ServeResponseHeaderBytes, '\0');
+        w->renderer->reset();
+        w->renderer->render(c->doc, c->out);
+        size_t length = c->out.size() - ServeResponseHeaderBytes;
+        if (length > UINT32_MAX) {
+            // Too long for the length field; the stream stays in step
+            std::string().swap(c->out);
+            setResponse(c->out, ServeFailed, "rendered output too large");
+        } else {
+            putU32(&c->out[0], 0);
+            putU32(&c->out[4], static_cast<uint32_t>(length));
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(doneMutex);
+            done.push_back(c);
+        }
+        uint64_t one = 1;
+        ssize_t n = write(wakeFd, &one, sizeof one);
+        (void)n;
+    }
+}
+
+void RenderServer::finishRequests() {
+    {
+        std::lock_guard<std::mutex> lock(doneMutex);
+        doneScratch.swap(done);
+    }
+    for (Connection* c : doneScratch) {
+        c->busy = false;
+        c->in.erase(0, ServeRequestHeaderBytes + c->doc.size());
+        bufferedInput -= ServeRequestHeaderBytes + c->doc.size();
+        c->doc = std::string_view();
+        if (c->hungUp) {
+            close(*c);
+            continue;
+        }
+        writeTo(*c);
+    }
+    doneScratch.clear();
+}
+
+void RenderServer::writeTo(Connection& c) {
+    while (c.written < c.out.size()) {
+        ssize_t n = send(c.fd, c.out.data() + c.written, c.out.size() - c.written, MSG_NOSIGNAL);
+        if (n > 0) {
+            c.written += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            watch(c, EPOLLOUT);
+            return;
+        }
+        close(c);
+        return;
+    }
+    if (c.closing) {
+        close(c);
+        return;
+    }
+    c.written = 0;
+    c.out.clear();
+    if (c.out.capacity() > KeptBufferBytes) std::string().swap(c.out);
+    if (c.in.capacity() > KeptBufferBytes && c.in.size() <= KeptBufferBytes) c.in.shrink_to_fit();
+
+    // Requests sent back to back may already be waiting
+    dispatch(c);
+    if (c.closing) writeTo(c);
+    else if (!c.busy) watch(c, EPOLLIN);
+}
+
+void RenderServer::watch(Connection& c, uint32_t events) {
+    if (c.events == events) return;
+    epoll_event ev{};
+    ev.events = events;
+    ev.data.fd = c.fd;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, c.fd, &ev);
+    c.events = events;
+}
+
+void RenderServer::close(Connection& c) {
+    // A worker still holds a busy connection; it goes once the worker is done
+    if (c.busy) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, c.fd, nullptr);
+        c.hungUp = true;
+        return;
+    }
+    int fd = c.fd;
+    bufferedInput -= c.in.size();
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    connections[fd].reset();
+}
+
+RenderClient::~RenderClient() {
+    if (fd >= 0) ::close(fd);
+}
+
+bool RenderClient::connect(const std::string& path) {
+    sockaddr_un addr;
+    if (!socketAddress(path, addr)) return false;
+    if (fd >= 0) ::close(fd);
+    fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return false;
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) == 0) return true;
+    int saved = errno;
+    ::close(fd);
+    fd = -1;
+    errno = saved;
+    return false;
+}
+
+namespace {
+
+bool sendAll(int fd, const char* p, size_t n) {
+    while (n) {
+        ssize_t w = send(fd, p, n, MSG_NOSIGNAL);
+        if (w < 0 && errno == EINTR) continue;
+        if (w <= 0) return false;
+        p += w;
+        n -= static_cast<size_t>(w);
+    }
+    return true;
+}
+
+bool recvAll(int fd, char* p, size_t n) {
+    while (n) {
+        ssize_t r = recv(fd, p, n, 0);
+        if (r < 0 && errno == EINTR) continue;
+        if (r == 0) errno = ECONNRESET;
+        if (r <= 0) return false;
+        p += r;
+        n -= static_cast<size_t>(r);
+    }
+    return true;
+}
+
+} // namespace
+
+bool RenderClient::render(std::string_view doc, const RenderOptions& opts, std::string& out) {
+    out.clear();
+    if (fd < 0) {
+        errno = ENOTCONN;
+        return false;
+    }
+    if (doc.size() > ServeMaxDocumentBytes) {
+        errno = EMSGSIZE;
+        return false;
+    }
+    header.assign(ServeRequestHeaderBytes, '\0');
+    putU32(&header[0], static_cast<uint32_t>(doc.size()));
+    putU32(&header[4], (opts.useColor ? ServeColor : 0) | (opts.showUrls ? ServeUrls : 0));
+    putU32(&header[8], static_cast<uint32_t>(opts.wrap));
+    putU32(&header[12], static_cast<uint32_t>(opts.tableRowLimit));
+    if (!sendAll(fd, header.data(), header.size()) || !sendAll(fd, doc.data(), doc.size())) return false;
+
+    header.resize(ServeResponseHeaderBytes);
+    if (!recvAll(fd, &header[0], header.size())) return false;
+    uint32_t status = getU32(header.data());
+    out.resize(getU32(header.data() + 4));
+    if (!recvAll(fd, &out[0], out.size())) {
+        out.clear();
+        return false;
+    }
+    return status == 0;
+}
+
+} // namespace mdmni
@@ -0,0 +1,113 @@
+#ifndef RENDER_SERVER_H
+#define RENDER_SERVER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+#include "RenderOptions.h"
+
+namespace mdmni {
+
+// Wire format of --serve. Every integer is unsigned 32-bit little-endian.
+//   request:  length, flags (ServeColor | ServeUrls), wrap, table rows,
+//             then length bytes of markdown
+//   response: status (0, or ServeFailed with an error message as the body),
+//             length, then length bytes of rendered output
+// A connection may carry any number of requests, answered in order.
+constexpr size_t ServeRequestHeaderBytes = 16;
+constexpr size_t ServeResponseHeaderBytes = 8;
+constexpr uint32_t ServeColor = 1;
+constexpr uint32_t ServeUrls = 2;
+constexpr uint32_t ServeFailed = 1;
+constexpr uint32_t ServeMaxDocumentBytes = 64u << 20;
+// Input held for all connections together. A connection whose next read
+// would go past it is answered with ServeFailed and closed, so clients that
+// never finish their requests cannot run the server out of memory.
+constexpr size_t ServeMaxBufferedBytes = size_t(256) << 20;
+
+// Renders requests from many clients over a Unix socket. One thread runs an
+// epoll loop that reads requests and writes responses without blocking;
+// worker threads render, each keeping warm Renderers for the option sets it
+// has seen, so a request costs no process start and, once the renderers and
+// buffers have grown, no allocation.
+class RenderServer {
+public:
+    explicit RenderServer(unsigned workers);
+    ~RenderServer();
+
+    RenderServer(const RenderServer&) = delete;
+    RenderServer& operator=(const RenderServer&) = delete;
+
+    // Listen on a socket at path. A stale socket left there by a server
+    // that is gone is replaced. False with errno set on failure.
+    bool listen(const std::string& path);
+    // Serve until stop(); false with errno set if the event loop fails.
+    // The socket file is removed on return.
+    bool run();
+    // Make run() return soon; safe from a signal handler or another thread
+    void stop();
+
+private:
+    struct Connection;
+
+    unsigned workerCount;
+    std::string path;
+    int listenFd = -1;
+    int epollFd = -1;
+    int wakeFd = -1;  // eventfd: a worker finished a request, or stop()
+    std::atomic<bool> stopping{false};
+    std::vector<std::unique_ptr<Connection>> connections;  // by fd
+    size_t bufferedInput = 0;  // bytes in every connection's input buffer
+
+    std::mutex queueMutex;
+    std::condition_variable queued;
+    std::deque<Connection*> pending;  // requests waiting for a worker
+    bool shutdown = false;
+    std::mutex doneMutex;
+    std::vector<Connection*> done;    // rendered, waiting to be written
+    std::vector<Connection*> doneScratch;
+    std::vector<std::thread> workers;
+
+    void work();
+    void accept();
+    void readFrom(Connection& c);
+    void writeTo(Connection& c);
+    void finishRequests();
+    void dispatch(Connection& c);
+    void reply(Connection& c, uint32_t status, std::string_view message);
+    void watch(Connection& c, uint32_t events);
+    void close(Connection& c);
+};
+
+// A connection to a RenderServer, for --client and embedding
+class RenderClient {
+public:
+    RenderClient() = default;
+    ~RenderClient();
+
+    RenderClient(const RenderClient&) = delete;
+    RenderClient& operator=(const RenderClient&) = delete;
+
+    // False with errno set on failure
+    bool connect(const std::string& path);
+    // Render doc with opts on the server, replacing out with the result.
+    // False on failure, with out holding the server's error message or
+    // errno set when the connection failed.
+    bool render(std::string_view doc, const RenderOptions& opts, std::string& out);
+
+private:
+    int fd = -1;
+    std::string header;
+};
+
+} // namespace mdmni
+
+#endif // RENDER_SERVER_H
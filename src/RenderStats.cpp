@@ -0,0 +1,93 @@
+#include "RenderStats.h"
+#include <algorithm>
+#include <cstdio>
+
+namespace mdmni {
+
+namespace {
+
+const char* const PhaseNames[PhaseCount] = { "read", "classify", "inline", "table", "write" };
+// In LineKind order
+const char* const LineNames[LineKindCount] = { "blank", "text", "fence", "rule", "heading", "quote", "list", "table" };
+const char* const SpanNames[InlineSpanCount] = { "code", "bold", "italic", "link", "image" };
+
+} // namespace
+
+void RenderStats::merge(const RenderStats& o) {
+    for (size_t i = 0; i < PhaseCount; ++i) phaseNanos[i] += o.phaseNanos[i];
+    for (size_t i = 0; i < LineKindCount; ++i) lines[i] += o.lines[i];
+    for (size_t i = 0; i < InlineSpanCount; ++i) inlineSpans[i] += o.inlineSpans[i];
+    codeLines += o.codeLines;
+    bytesIn += o.bytesIn;
+    bytesOut += o.bytesOut;
+    outputWrites += o.outputWrites;
+    peakParagraphBytes = std::max(peakParagraphBytes, o.peakParagraphBytes);
+    peakTableBytes = std::max(peakTableBytes, o.peakTableBytes);
+    peakTableRows = std::max(peakTableRows, o.peakTableRows);
+    allocations += o.allocations;
+}
+
+void RenderStats::writeText(std::ostream& out) const {
+    char buf[128];
+    uint64_t total = 0;
+    for (uint64_t ns : phaseNanos) total += ns;
+    out << "time:\n";
+    for (size_t i = 0; i < PhaseCount; ++i) {
+        std::snprintf(buf, sizeof buf, "  %-10s %10.3f ms %5.1f%%\n", PhaseNames[i], phaseNanos[i] / 1e6,
+                      total ? 100.0 * phaseNanos[i] / total : 0.0);
+        out << buf;
+    }
+    std::snprintf(buf, sizeof buf, "  %-10s %10.3f ms\n", "total", total / 1e6);
+    out << buf;
+
+    out << "lines:\n";
+    for (size_t i = 0; i < LineKindCount; ++i) {
+        std::snprintf(buf, sizeof buf, "  %-10s %10llu\n", LineNames[i], static_cast<unsigned long long>(lines[i]));
+        out << buf;
+    }
+    std::snprintf(buf, sizeof buf, "  %-10s %10llu\n", "code", static_cast<unsigned long long>(codeLines));
+    out << buf;
+
+    out << "inline spans:\n";
+    for (size_t i = 0; i < InlineSpanCount; ++i) {
+        std::snprintf(buf, sizeof buf, "  %-10s %10llu\n", SpanNames[i],
+                      static_cast<unsigned long long>(inlineSpans[i]));
+        out << buf;
+    }
+
+    auto line = [&](const char* name, uint64_t v) {
+        std::snprintf(buf, sizeof buf, "%-22s %llu\n", name, static_cast<unsigned long long>(v));
+        out << buf;
+    };
+    line("bytes in:", bytesIn);
+    line("bytes out:", bytesOut);
+    line("output writes:", outputWrites);
+    line("peak paragraph bytes:", peakParagraphBytes);
+    line("peak table bytes:", peakTableBytes);
+    line("peak table rows:", peakTableRows);
+    line("allocations:", allocations);
+}
+
+void RenderStats::writeJson(std::ostream& out) const {
+    auto u = [](uint64_t v) { return static_cast<unsigned long long>(v); };
+    char buf[96];
+    out << "{\"ms\":{";
+    for (size_t i = 0; i < PhaseCount; ++i) {
+        std::snprintf(buf, sizeof buf, "%s\"%s\":%.3f", i ? "," : "", PhaseNames[i], phaseNanos[i] / 1e6);
+        out << buf;
+    }
+    out << "},\"lines\":{";
+    for (size_t i = 0; i < LineKindCount; ++i) out << (i ? "," : "") << '"' << LineNames[i] << "\":" << u(lines[i]);
+    out << ",\"code\":" << u(codeLines) << "},\"inline_spans\":{";
+    for (size_t i = 0; i < InlineSpanCount; ++i)
+        out << (i ? "," : "") << '"' << SpanNames[i] << "\":" << u(inlineSpans[i]);
+    out << "},\"bytes_in\":" << u(bytesIn)
+        << ",\"bytes_out\":" << u(bytesOut)
+        << ",\"output_writes\":" << u(outputWrites)
+        << ",\"peak_paragraph_bytes\":" << u(peakParagraphBytes)
+        << ",\"peak_table_bytes\":" << u(peakTableBytes)
+        << ",\"peak_table_rows\":" << u(peakTableRows)
+        << ",\"allocations\":" << u(allocations) << "}\n";
+}
+
+} // namespace mdmni
@@ -0,0 +1,94 @@
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include "DocumentEvents.h"
+#include "LineClassifier.h"
+
+// Statistics hooks are compiled in unless MDMNI_STATS is defined to 0. When
+// compiled in, they cost one untaken branch each while no RenderStats is set.
+#ifndef MDMNI_STATS
+#define MDMNI_STATS 1
+#endif
+
+namespace mdmni {
+
+constexpr bool StatsCompiled = MDMNI_STATS != 0;
+
+// Where rendering time goes. At any moment exactly one phase is charged.
+enum class Phase {
+    Read,      // fetching and splitting input lines
+    Classify,  // block classification and everything not charged elsewhere
+    Inline,    // inline styling and wrapping
+    Table,     // table splitting, measuring and layout
+    Write,     // handing output to the stream
+};
+constexpr size_t PhaseCount = 5;
+
+// Counters and timings collected by a Renderer given one with setStats()
+struct RenderStats {
+    uint64_t phaseNanos[PhaseCount] = {};
+    uint64_t lines[LineKindCount] = {};  // per LineKind, outside fences
+    uint64_t codeLines = 0;        // lines inside fences, closing fences included
+    uint64_t inlineSpans[InlineSpanCount] = {};
+    uint64_t bytesIn = 0;
+    uint64_t bytesOut = 0;
+    uint64_t outputWrites = 0;     // writes handed to the output stream
+    uint64_t peakParagraphBytes = 0;
+    uint64_t peakTableBytes = 0;   // cell text of the largest buffered table
+    uint64_t peakTableRows = 0;
+    uint64_t allocations = 0;      // left to programs that count them
+
+    // Charge the time since the last switch to the current phase and move to p
+    Phase enter(Phase p) {
+        auto now = std::chrono::steady_clock::now();
+        phaseNanos[static_cast<size_t>(current)] +=
+            static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(now - since).count());
+        since = now;
+        Phase previous = current;
+        current = p;
+        return previous;
+    }
+    // Begin charging Classify; called at the start of each render
+    void start() {
+        since = std::chrono::steady_clock::now();
+        current = Phase::Classify;
+    }
+    // Charge the time up to now
+    void stop() { enter(current); }
+
+    // Add another renderer's counts (peaks take the larger value)
+    void merge(const RenderStats& o);
+
+    void writeText(std::ostream& out) const;
+    // One JSON object on a single line
+    void writeJson(std::ostream& out) const;
+
+private:
+    Phase current = Phase::Classify;
+    std::chrono::steady_clock::time_point since;
+};
+
+// Charges its lifetime to a phase, then returns to the phase it interrupted
+class PhaseScope {
+public:
+    PhaseScope(RenderStats* s, Phase p) : stats(StatsCompiled ? s : nullptr) {
+        if (stats) previous = stats->enter(p);
+    }
+    ~PhaseScope() {
+        if (stats) stats->enter(previous);
+    }
+    PhaseScope(const PhaseScope&) = delete;
+    PhaseScope& operator=(const PhaseScope&) = delete;
+
+private:
+    RenderStats* stats;
+    Phase previous = Phase::Classify;
+};
+
+} // namespace mdmni
+
+#endif // RENDER_STATS_H
@@ -2,34 +2,71 @@
 #define RENDERER_H
 
 #include <string>
+#include <string_view>
 #include <vector>
+#include <istream>
+#include <memory>
 #include <ostream>
+#include "AnsiWriter.h"
+#include "DocumentParser.h"
+#include "InputSource.h"
+#include "LineClassifier.h"
+#include "OutputSink.h"
+#include "RenderOptions.h"
+#include "RenderStats.h"
+#include "Theme.h"
 
 namespace mdmni {
 
+// Bump whenever the output for a given input and set of options changes
+constexpr unsigned RendererVersion = 2;
+
 class Renderer {
 public:
     Renderer(bool useColor = true, bool showUrls = true, int wrap = 0);
+    explicit Renderer(const RenderOptions& opts);
+    ~Renderer();
     void render(const std::vector<std::string>& lines, std::ostream& out);
+    // Read lines from in until EOF, writing each block as soon as it is complete
+    void render(std::istream& in, std::ostream& out);
+    void render(InputSource& in, std::ostream& out);
+    // Render a whole document, appending the result to out. Internal buffers
+    // are kept between calls, so once a renderer (and out) have grown to fit
+    // the documents it sees, rendering does not allocate.
+    void render(std::string_view doc, std::string& out);
+
+    // Forget any partial block and fence state, keeping allocated buffers,
+    // so the renderer can start on an unrelated document
+    void reset();
+
+    // Push-style streaming: feed one line (without its newline) at a time,
+    // then call finish() to flush whatever block is still open.
+    void feed(std::string_view line, std::ostream& out);
+    void finish(std::ostream& out);
+
+    // Resume at a BlockIndex checkpoint: take over the fence state recorded
+    // there. The renderer must not hold a partial block.
+    void restoreFence(const FenceState& fence);
+
+    // How eagerly rendered output is handed to the stream (default: Full)
+    void setFlushPolicy(FlushPolicy policy) { writer->output().setPolicy(policy); }
+    // Escape sequences used when colors are on (default: Theme::standard())
+    void setTheme(const Theme& t) { writer->setTheme(t); }
+    // Add counters and phase timings of later renders to s, which must
+    // outlive them; nullptr stops collecting
+    void setStats(RenderStats* s);
 private:
-    bool useColor;
-    bool showUrls;
-    int wrap;
-
-    bool insideCodeFences = false;
-    char codeFenceChar = '\0';
-    int codeFenceLen = 0;
-    std::vector<std::string> paragraph;
-    std::vector<std::string> tableBuffer;
-
-    void processLine(const std::string& line, std::ostream& out);
-    void flushParagraph(std::ostream& out);
-    void flushTable(std::ostream& out);
-    bool isCodeFenceStart(const std::string& line);
-    bool isCodeFenceEnd(const std::string& line);
-    bool isHr(const std::string& line);
-    std::string applyInline(const std::string& text);
-    std::string styleHeading(int level, const std::string& text);
+    // Parsing and terminal output are separate stages. Both are compiled for
+    // each setting of colors and URLs, and the pair is chosen once, here at
+    // construction: the parser calls the writer directly, and neither checks
+    // the options per line.
+    struct Pipeline;
+    template<bool Color, bool Urls> struct PipelineAs;
+    std::unique_ptr<Pipeline> pipeline;
+    AnsiWriterBase* writer;  // the pipeline's
+    RenderStats* stats = nullptr;
+
+    void endDocument();
 };
 
 } // namespace mdmni
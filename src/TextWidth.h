@@ -0,0 +1,28 @@
+#ifndef TEXT_WIDTH_H
+#define TEXT_WIDTH_H
+
+#include <cstddef>
+#include <string_view>
+
+namespace mdmni {
+
+// Terminal columns taken by a code point: 0 for control (other than tab),
+// combining and other zero-width characters, 2 for East Asian wide and
+// fullwidth characters (including emoji), 1 for everything else
+int codepointWidth(char32_t cp);
+
+// Columns taken by the UTF-8 character starting at s[i]; len is set to its
+// length in bytes. A malformed byte counts as one column on its own, except
+// stray continuation bytes, which take none.
+int charWidth(std::string_view s, size_t i, size_t& len);
+
+// Length of the SGR sequence (ESC [ digits and semicolons m) starting at
+// s[i], or 0 if there is none
+size_t sgrLength(std::string_view s, size_t i);
+
+// Visible terminal columns of styled text; SGR sequences take none
+size_t displayWidth(std::string_view s);
+
+} // namespace mdmni
+
+#endif // TEXT_WIDTH_H
@@ -0,0 +1,211 @@
+#include "TextWrap.h"
+#include "TextWidth.h"
+#include "ByteScan.h"
+#include <algorithm>
+#include <cstring>
+
+namespace mdmni {
+
+//
+// SGR state
+//
+
+void SgrState::apply(std::string_view sequence) {
+    // Parameters between "ESC [" and "m"; an empty one means 0
+    std::string_view params = sequence.substr(2, sequence.size() - 3);
+    int values[32];
+    size_t count = 0;
+    size_t i = 0;
+    do {
+        // Saturates above 255, past any meaningful parameter, so long digit
+        // runs in the document cannot overflow
+        unsigned v = 0;
+        while (i < params.size() && params[i] != ';') {
+            unsigned digit = static_cast<unsigned char>(params[i++]) - '0';
+            v = v > 255 || digit > 9 ? 256 : v * 10 + digit;
+        }
+        if (count < 32) values[count++] = static_cast<int>(v);
+    } while (i++ < params.size());
+
+    for (size_t k = 0; k < count; ++k) {
+        int p = values[k];
+        if (p == 0) {
+            attrs = 0;
+            fg.clear();
+            bg.clear();
+        } else if (p >= 1 && p <= 9) {
+            attrs |= 1u << p;
+        } else if (p == 21 || p == 22) {
+            attrs &= ~((1u << 1) | (1u << 2));
+        } else if (p == 25) {
+            attrs &= ~((1u << 5) | (1u << 6));
+        } else if (p >= 23 && p <= 29) {
+            attrs &= ~(1u << (p - 20));
+        } else if ((p >= 30 && p <= 37) || (p >= 90 && p <= 97)) {
+            fg = std::to_string(p);
+        } else if ((p >= 40 && p <= 47) || (p >= 100 && p <= 107)) {
+            bg = std::to_string(p);
+        } else if (p == 39) {
+            fg.clear();
+        } else if (p == 49) {
+            bg.clear();
+        } else if ((p == 38 || p == 48) && k + 1 < count) {
+            // 38;5;n (256 colors) or 38;2;r;g;b (direct color)
+            size_t extra = values[k + 1] == 5 ? 2 : values[k + 1] == 2 ? 4 : 0;
+            if (extra == 0 || k + extra >= count) break;
+            std::string& color = p == 38 ? fg : bg;
+            color = std::to_string(p);
+            for (size_t e = 1; e <= extra; ++e)
+                color += ';' + std::to_string(values[k + e]);
+            k += extra;
+        }
+    }
+}
+
+void SgrState::append(std::string& out) const {
+    if (!active()) return;
+    out += "\033[";
+    bool first = true;
+    auto param = [&](std::string_view p) {
+        if (!first) out += ';';
+        out += p;
+        first = false;
+    };
+    for (int a = 1; a <= 9; ++a) {
+        if (attrs & (1u << a)) {
+            char digit = static_cast<char>('0' + a);
+            param(std::string_view(&digit, 1));
+        }
+    }
+    if (!fg.empty()) param(fg);
+    if (!bg.empty()) param(bg);
+    out += 'm';
+}
+
+//
+// Word wrapping
+//
+
+namespace {
+
+class Wrapper {
+public:
+    Wrapper(std::string_view text, size_t width, size_t column,
+            std::string_view indent, size_t indentColumns, std::string& out)
+        : text(text), width(std::max(width, indentColumns + 1)), indent(indent),
+          indentColumns(indentColumns), out(out), col(column), lineStart(column) {}
+
+    void run() {
+        size_t spaces = 0;
+        size_t i = 0;
+        while (i < text.size()) {
+            if (text[i] == ' ') {
+                ++spaces;
+                ++i;
+                continue;
+            }
+            // Measure the word up to the next space
+            size_t end = i;
+            size_t w = 0;
+            while (end < text.size() && text[end] != ' ') {
+                // Printable ASCII other than space: one column per byte
+                size_t run = findOutsideRange(text.data() + end, text.size() - end, 0x21, 0x7E);
+                w += run;
+                end += run;
+                if (end == text.size() || text[end] == ' ') break;
+                if (size_t len = sgrLength(text, end)) {
+                    end += len;
+                    continue;
+                }
+                size_t len;
+                w += charWidth(text, end, len);
+                end += len;
+            }
+            if (w == 0) {
+                // Only styling: spaces before it stay pending
+                copy(i, end);
+                i = end;
+                continue;
+            }
+
+            // Spaces at the start of a continuation line are dropped
+            size_t lead = broken && col == lineStart ? 0 : spaces;
+            if (col + lead + w <= width) {
+                out.append(lead, ' ');
+                copy(i, end);
+                col += lead + w;
+            } else {
+                if (col > lineStart) breakLine();
+                if (col + w <= width) {
+                    copy(i, end);
+                    col += w;
+                } else {
+                    breakWord(i, end);
+                }
+            }
+            spaces = 0;
+            i = end;
+        }
+    }
+
+private:
+    std::string_view text;
+    size_t width;
+    std::string_view indent;
+    size_t indentColumns;
+    std::string& out;
+    size_t col;          // current output column
+    size_t lineStart;    // column of the first character on this line
+    bool broken = false; // on a continuation line
+    SgrState state;
+
+    void breakLine() {
+        if (state.active()) out += "\033[0m";
+        out += '\n';
+        out += indent;
+        state.append(out);
+        col = lineStart = indentColumns;
+        broken = true;
+    }
+
+    // Copy text[begin, end) to out, tracking the SGR sequences in it
+    void copy(size_t begin, size_t end) {
+        while (begin < end) {
+            const void* esc = std::memchr(text.data() + begin, '\033', end - begin);
+            size_t stop = esc ? static_cast<const char*>(esc) - text.data() : end;
+            out.append(text.data() + begin, stop - begin);
+            if (stop == end) return;
+            size_t len = sgrLength(text, stop);
+            if (len) state.apply(text.substr(stop, len));
+            else len = 1;
+            out.append(text.data() + stop, len);
+            begin = stop + len;
+        }
+    }
+
+    // A word that does not fit on a line of its own: break between characters
+    void breakWord(size_t begin, size_t end) {
+        while (begin < end) {
+            size_t len = sgrLength(text, begin);
+            if (len) {
+                copy(begin, begin + len);
+                begin += len;
+                continue;
+            }
+            size_t w = static_cast<size_t>(charWidth(text, begin, len));
+            if (w && col + w > width && col > lineStart) breakLine();
+            out.append(text.data() + begin, len);
+            col += w;
+            begin += len;
+        }
+    }
+};
+
+} // namespace
+
+void wrapText(std::string_view text, size_t width, size_t column,
+              std::string_view indent, size_t indentColumns, std::string& out) {
+    Wrapper(text, width, column, indent, indentColumns, out).run();
+}
+
+} // namespace mdmni
@@ -0,0 +1,39 @@
+#ifndef TEXT_WRAP_H
+#define TEXT_WRAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace mdmni {
+
+// Graphic rendition in effect after a run of SGR sequences, so that it can
+// be closed at a line break and reopened on the next line
+class SgrState {
+public:
+    // Update the state from one complete sequence (ESC [ ... m)
+    void apply(std::string_view sequence);
+    bool active() const { return attrs != 0 || !fg.empty() || !bg.empty(); }
+    // Append a single sequence that re-establishes the state
+    void append(std::string& out) const;
+
+private:
+    uint16_t attrs = 0;  // bit n set for SGR n, 1..9
+    std::string fg;      // "31", "38;5;208", ... or empty for the default
+    std::string bg;
+};
+
+// Greedy word wrap of styled text into out. Lines break at spaces; a word
+// wider than a whole line is broken between characters. The first line
+// starts at column (whatever the caller has already written there); every
+// further line starts with indent, which takes indentColumns. Styles open
+// at a break are closed before the newline and reopened after the indent.
+// Every byte of text is examined a bounded number of times, so very long
+// paragraphs wrap in linear time.
+void wrapText(std::string_view text, size_t width, size_t column,
+              std::string_view indent, size_t indentColumns, std::string& out);
+
+} // namespace mdmni
+
+#endif // TEXT_WRAP_H
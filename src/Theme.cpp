@@ -0,0 +1,101 @@
+#include "Theme.h"
+#include <utility>
+#include <vector>
+
+//
+// ANSI escape codes
+//
+
+// CSI = Control Sequence Introducer
+static const std::string CSI = "\033[";
+
+// Bold and underline codes
+static const std::string BOLD = "1";
+static const std::string DIM = "2";
+static const std::string ITALIC = "3";
+static const std::string UNDERLINE = "4";
+
+// Color codes
+static const std::string RED = "31";
+static const std::string GREEN = "32";
+static const std::string YELLOW = "33";
+static const std::string BLUE = "34";
+static const std::string MAGENTA = "35";
+static const std::string CYAN = "36";
+static const std::string WHITE = "37";
+static const std::string BRIGHT_BLACK = "90";
+static const std::string BRIGHT_RED = "91";
+static const std::string BRIGHT_GREEN = "92";
+static const std::string BRIGHT_YELLOW = "93";
+static const std::string BRIGHT_BLUE = "94";
+static const std::string BRIGHT_MAGENTA = "95";
+static const std::string BRIGHT_CYAN = "96";
+static const std::string BRIGHT_WHITE = "97";
+
+// Background colours
+static const std::string BG_RED = "41";
+static const std::string BG_GREEN = "42";
+static const std::string BG_YELLOW = "43";
+static const std::string BG_BLUE = "44";
+static const std::string BG_MAGENTA = "45";
+static const std::string BG_CYAN = "46";
+static const std::string BG_WHITE = "47";
+static const std::string BG_BRIGHT_BLACK = "100";
+static const std::string BG_BRIGHT_RED = "101";
+static const std::string BG_BRIGHT_GREEN = "102";
+static const std::string BG_BRIGHT_YELLOW = "103";
+static const std::string BG_BRIGHT_BLUE = "104";
+static const std::string BG_BRIGHT_MAGENTA = "105";
+static const std::string BG_BRIGHT_CYAN = "106";
+static const std::string BG_BRIGHT_WHITE = "107";
+
+static std::string textStyle() {
+    return CSI + "0m";
+}
+
+template<typename... Args>
+static std::string textStyle(Args&&... args) {
+    std::vector<std::string> parts;
+    parts.reserve(sizeof...(Args));
+    // Fold expression to emplace each argument (works with std::string or string literals)
+    (parts.emplace_back(std::forward<Args>(args)), ...);
+
+    std::string joined;
+    for (size_t i = 0; i < parts.size(); ++i) {
+        if (i) joined += ";";
+        joined += parts[i];
+    }
+    return CSI + joined + "m";
+}
+
+namespace mdmni {
+
+static Theme makeStandardTheme() {
+    Theme t;
+    t.reset = textStyle();
+    t.heading[0] = textStyle(BRIGHT_CYAN, BOLD, UNDERLINE);
+    t.heading[1] = textStyle(BRIGHT_CYAN, BOLD);
+    t.heading[2] = textStyle(BRIGHT_YELLOW, BOLD);
+    t.heading[3] = textStyle(BRIGHT_MAGENTA);
+    t.heading[4] = textStyle(CYAN);
+    t.heading[5] = textStyle(CYAN);
+    t.codeBlock = textStyle(GREEN);
+    t.quoteBar = textStyle(BRIGHT_BLACK);
+    t.quoteText = textStyle(ITALIC);
+    t.listBullet = textStyle(BRIGHT_BLUE);
+    t.tableHeader = textStyle(BOLD);
+    t.bold = textStyle(BOLD);
+    t.italic = textStyle(ITALIC);
+    t.code = textStyle(BRIGHT_WHITE, BG_BRIGHT_BLACK);
+    t.link = textStyle(BLUE, UNDERLINE);
+    t.image = textStyle(MAGENTA, BOLD);
+    t.url = textStyle(BRIGHT_BLACK);
+    return t;
+}
+
+const Theme& Theme::standard() {
+    static const Theme theme = makeStandardTheme();
+    return theme;
+}
+
+} // namespace mdmni
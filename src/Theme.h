@@ -0,0 +1,33 @@
+#ifndef THEME_H
+#define THEME_H
+
+#include <string>
+
+namespace mdmni {
+
+// Ready-made escape sequences for every styled element. A theme is built
+// once; the renderer only copies these bytes into its output. Any field may
+// be replaced (or emptied) to restyle an element.
+struct Theme {
+    std::string reset;
+    std::string heading[6];   // levels 1 to 6
+    std::string codeBlock;    // fenced code lines
+    std::string quoteBar;
+    std::string quoteText;
+    std::string listBullet;
+    std::string tableHeader;
+    // Inline spans
+    std::string bold;
+    std::string italic;
+    std::string code;
+    std::string link;
+    std::string image;
+    std::string url;
+
+    // The built-in colors
+    static const Theme& standard();
+};
+
+} // namespace mdmni
+
+#endif // THEME_H
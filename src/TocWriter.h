@@ -0,0 +1,53 @@
+#ifndef TOC_WRITER_H
+#define TOC_WRITER_H
+
+#include <string>
+#include <string_view>
+#include "DocumentEvents.h"
+#include "Outline.h"
+#include "OutputSink.h"
+
+namespace mdmni {
+
+// The document outline: each heading's outline number and text on a line of
+// its own, indented two spaces per level of nesting, as printed by --toc
+class TocWriter final : public DocumentHandler {
+public:
+    OutputSink& output() { return sink; }
+
+    void beginBlock(const Block& b) override {
+        if (b.kind != BlockKind::Heading) return;
+        inHeading = true;
+        title.clear();
+    }
+    void endBlock(const Block& b) override {
+        if (b.kind != BlockKind::Heading) return;
+        inHeading = false;
+        // Numbered and trimmed as buildOutline() does, so the lines match --toc
+        size_t depth = numbering.next(b.level, number);
+        trimTitle(title);
+        sink.repeat("  ", depth - 1);
+        sink << number << ' ' << title;
+        sink.newline();
+    }
+    void text(std::string_view s) override {
+        if (inHeading) title.append(s.data(), s.size());
+    }
+    void beginSpan(InlineSpan, std::string_view) override {}
+    void endSpan(InlineSpan, std::string_view) override {}
+    void codeLine(std::string_view) override {}
+    void rule() override {}
+    void blankLine() override {}
+    void endDocument() override { sink.detach(); }
+
+private:
+    OutputSink sink;
+    OutlineNumbering numbering;
+    std::string number;
+    std::string title;
+    bool inHeading = false;
+};
+
+} // namespace mdmni
+
+#endif // TOC_WRITER_H
@@ -1,13 +1,34 @@
 #include "Renderer.h"
+#include "DocumentParser.h"
+#include "HtmlWriter.h"
+#include "Outline.h"
+#include "PlainWriter.h"
+#include "TocWriter.h"
+#include "ParallelRender.h"
+#include "BatchRender.h"
+#include "BlockIndex.h"
+#include "FdStream.h"
+#include "Pager.h"
+#include "RenderCache.h"
+#include "RenderServer.h"
+#include "RenderStats.h"
+#include <algorithm>
+#include <atomic>
+#include <new>
 #include <iostream>
-#include <fstream>
 #include <vector>
 #include <string>
+#include <cerrno>
+#include <cstdio>
 #include <cstring>
 #include <sstream>
 #include <cstdlib>
+#include <csignal>
+#include <fstream>
+#include <memory>
 #include <unistd.h>
 #include <sys/wait.h>
+#include <thread>
 
 #define BASENAME_OF(path) \
     ((path) ? \
@@ -15,6 +36,182 @@
          (std::strrchr((path), '\\') ? std::strrchr((path), '\\') + 1 : (path))) \
      : "")
 
+// Heap allocations are counted for --stats only; otherwise the count is
+// skipped after one relaxed load
+static std::atomic<bool> countAllocations{false};
+static std::atomic<uint64_t> allocationCount{0};
+
+void* operator new(std::size_t n) {
+    if (countAllocations.load(std::memory_order_relaxed)) allocationCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(n ? n : 1)) return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+static void reportStats(mdmni::RenderStats& stats, bool json) {
+    stats.allocations = allocationCount.load();
+    std::cout.flush();
+    if (json) stats.writeJson(std::cerr);
+    else stats.writeText(std::cerr);
+}
+
+// Report a read error that cut in short; true if there was one
+static bool readFailed(const mdmni::InputSource* in, const std::string& file) {
+    if (!in || !in->error()) return false;
+    std::cerr << "mdmni: " << (file.empty() || file == "-" ? "stdin" : file) << ": read error: "
+              << std::strerror(in->error()) << std::endl;
+    return true;
+}
+
+// --emit: parse the input once and hand the events to one writer per
+// "kind:path" in spec, path "-" being stdout
+static int emitOutputs(const std::string& spec, const std::string& file, const mdmni::RenderOptions& opts,
+                       mdmni::RenderStats* stats) {
+    struct Output {
+        std::unique_ptr<mdmni::DocumentHandler> writer;
+        mdmni::OutputSink* sink;
+        std::string path;
+        std::unique_ptr<std::ofstream> file;
+    };
+    std::vector<Output> outputs;
+    mdmni::DocumentFanout fanout;
+    auto add = [&](auto writer, const std::string& path) {
+        Output o;
+        o.sink = &writer->output();
+        o.sink->setStats(stats);
+        o.writer = std::move(writer);
+        o.path = path;
+        outputs.push_back(std::move(o));
+    };
+
+    std::istringstream items(spec);
+    for (std::string item; std::getline(items, item, ',');) {
+        size_t colon = item.find(':');
+        std::string kind = item.substr(0, colon);
+        std::string path = colon == std::string::npos ? "-" : item.substr(colon + 1);
+        if (kind == "ansi") {
+            auto w = mdmni::makeAnsiWriter(opts);
+            w->setStats(stats);
+            add(std::move(w), path);
+        } else if (kind == "plain") {
+            add(std::make_unique<mdmni::PlainWriter>(), path);
+        } else if (kind == "html") {
+            add(std::make_unique<mdmni::HtmlWriter>(), path);
+        } else if (kind == "toc") {
+            add(std::make_unique<mdmni::TocWriter>(), path);
+        } else {
+            std::cerr << "mdmni: unknown --emit output: " << kind << " (ansi, plain, html or toc)" << std::endl;
+            return 2;
+        }
+    }
+
+    auto in = mdmni::InputSource::open(file);
+    if (!in) {
+        std::cerr << "mdmni: file not found: " << file << std::endl;
+        return 2;
+    }
+    for (Output& o : outputs) {
+        if (o.path == "-" || o.path.empty()) {
+            o.sink->attach(std::cout);
+        } else {
+            o.file = std::make_unique<std::ofstream>(o.path, std::ios::binary);
+            if (!*o.file) {
+                std::cerr << "mdmni: " << o.path << ": " << std::strerror(errno) << std::endl;
+                return 2;
+            }
+            o.sink->attach(*o.file);
+        }
+        fanout.add(o.writer.get());
+    }
+
+    mdmni::DocumentParser<mdmni::DocumentHandler> parser(fanout);
+    parser.setStats(stats);
+    if (stats) stats->start();
+    std::string_view line;
+    for (;;) {
+        bool more;
+        {
+            mdmni::PhaseScope phase(stats, mdmni::Phase::Read);
+            more = in->nextLine(line);
+        }
+        if (!more) break;
+        parser.line(line);
+    }
+    parser.finish();
+    if (stats) stats->stop();
+
+    int status = readFailed(in.get(), file) ? 2 : 0;
+    for (Output& o : outputs) {
+        if (o.file) o.file->close();
+        std::ostream& out = o.file ? static_cast<std::ostream&>(*o.file) : std::cout;
+        if (!out) {
+            std::cerr << "mdmni: " << (o.file ? o.path : "stdout") << ": write failed" << std::endl;
+            status = 2;
+        }
+    }
+    return status;
+}
+
+// --serve: SIGINT and SIGTERM end the event loop, which removes the socket
+static mdmni::RenderServer* activeServer = nullptr;
+
+static void stopServer(int) {
+    if (activeServer) activeServer->stop();
+}
+
+static int serve(const std::string& path, unsigned workers) {
+    mdmni::RenderServer server(workers);
+    if (!server.listen(path)) {
+        std::cerr << "mdmni: cannot listen on " << path << ": " << std::strerror(errno) << std::endl;
+        return 2;
+    }
+    activeServer = &server;
+    struct sigaction sa{};
+    sa.sa_handler = stopServer;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    bool ok = server.run();
+    activeServer = nullptr;
+    if (!ok) {
+        std::cerr << "mdmni: " << path << ": " << std::strerror(errno) << std::endl;
+        return 2;
+    }
+    return 0;
+}
+
+// --client: have the server at path render file with opts
+static int renderRemote(const std::string& path, const std::string& file, const mdmni::RenderOptions& opts) {
+    auto in = mdmni::InputSource::open(file);
+    if (!in) {
+        std::cerr << "mdmni: file not found: " << file << std::endl;
+        return 2;
+    }
+    mdmni::RenderClient client;
+    if (!client.connect(path)) {
+        std::cerr << "mdmni: cannot connect to " << path << ": " << std::strerror(errno) << std::endl;
+        return 2;
+    }
+    std::string storage;
+    std::string out;
+    std::string_view doc = in->remaining(storage);
+    if (readFailed(in.get(), file)) return 2;
+    if (!client.render(doc, opts, out)) {
+        std::cerr << "mdmni: " << path << ": " << (out.empty() ? std::strerror(errno) : out.c_str()) << std::endl;
+        return 2;
+    }
+    std::cout.write(out.data(), static_cast<std::streamsize>(out.size()));
+    std::cout.flush();
+    return std::cout ? 0 : 2;
+}
+
 static std::vector<std::string> splitArgs(const std::string& s) {
     std::vector<std::string> result;
     std::istringstream iss(s);
@@ -25,30 +222,99 @@ static std::vector<std::string> splitArgs(const std::string& s) {
 
 void usageExit(const std::string& progName, int code=0) {
     std::cout << progName << " - minimal markdown pager\n\n";
-    std::cout << "Usage: " << progName << " [OPTIONS] [file]\n";
-    std::cout << "If file is omitted or '-' is given, read from stdin.\n\n";
+    std::cout << "Usage: " << progName << " [OPTIONS] [file...]\n";
+    std::cout << "If file is omitted or '-' is given, read from stdin. Several files are\n";
+    std::cout << "rendered one after another, unless an output directory or suffix is given.\n\n";
     std::cout << "Options:\n";
     std::cout << "  -h, --help        Show this help message and exit\n";
     std::cout << "  -w, --wrap N      Wrap output to width N (0 = no wrap)\n";
+    std::cout << "  -j, --jobs N      Render on N threads (0 = one per core)\n";
     std::cout << "  -p                Pipe output through pager (PAGER env or 'less -R')\n";
+    std::cout << "      --builtin-pager  Page with the built-in pager, rendering only what is shown\n";
+    std::cout << "      --watch       Like --builtin-pager, updating the view whenever file is saved\n";
     std::cout << "      --no-color    Disable ANSI colors\n";
     std::cout << "      --no-urls     Do not show URLs after links/images\n";
+    std::cout << "      --line-buffered  Flush output after every line\n";
+    std::cout << "      --table-rows N  Size table columns from the first N rows, then stream\n";
+    std::cout << "      --cache       Reuse renderings cached in $XDG_CACHE_HOME/mdmni\n";
+    std::cout << "      --batch LIST  Also render the files listed in LIST, one path per line\n";
+    std::cout << "      --output-dir DIR  Write each file's rendering to a file under DIR\n";
+    std::cout << "      --output-suffix SUF  Output file suffix replacing .md (default .txt)\n";
+    std::cout << "      --stats[=json]  Report timings and counters on stderr when done\n";
+    std::cout << "      --toc         Print the numbered outline of headings\n";
+    std::cout << "      --section S   Render only the section titled S, or numbered S (e.g. 3.2)\n";
+    std::cout << "      --emit LIST   Parse once and write each kind:path in LIST, e.g.\n";
+    std::cout << "                    ansi:out.txt,plain:out.idx (kinds: ansi plain html toc;\n";
+    std::cout << "                    path - is stdout)\n";
+    std::cout << "      --serve PATH  Render requests from clients on Unix socket PATH, on -j\n";
+    std::cout << "                    worker threads (default one per core)\n";
+    std::cout << "      --client PATH  Render file on the server at PATH with these options\n";
     std::exit(code);
 }
 
 int main(int argc, char** argv) {
+    // All output goes through the renderer's own buffer; no need to sync with stdio
+    std::ios::sync_with_stdio(false);
+
     std::string progName = BASENAME_OF(argv[0]);
-    std::string file;
+    std::vector<std::string> files;
+    std::string batchList;
+    std::string outputDir;
+    std::string outputSuffix;
+    std::string emit;
+    std::string section;
+    std::string servePath;
+    std::string clientPath;
     int wrap = 0;
+    bool wrapGiven = false;
     bool paging = false;
     bool noColor = false;
     bool noUrls = false;
+    bool lineBuffered = false;
+    bool builtinPager = false;
+    bool watch = false;
+    bool useCache = false;
+    unsigned jobs = 1;
+    bool jobsSet = false;
+    size_t tableRows = 0;
+    bool stats = false;
+    bool statsJson = false;
+    bool toc = false;
 
     for (int i = 1; i < argc; ++i) {
         std::string a = argv[i];
         if (a == "-w" || a == "--wrap") {
             if (argc > i + 1) {
                 wrap = std::atoi(argv[++i]);
+                wrapGiven = true;
+            }
+            else {
+                usageExit(progName, -1);
+            }
+        } else if (a == "-j" || a == "--jobs") {
+            if (argc > i + 1) {
+                int n = std::atoi(argv[++i]);
+                jobs = n > 0 ? static_cast<unsigned>(n) : std::max(1u, std::thread::hardware_concurrency());
+                jobsSet = true;
+            }
+            else {
+                usageExit(progName, -1);
+            }
+        } else if (a == "--table-rows") {
+            if (argc > i + 1) {
+                int n = std::atoi(argv[++i]);
+                tableRows = n > 0 ? static_cast<size_t>(n) : 0;
+            }
+            else {
+                usageExit(progName, -1);
+            }
+        } else if (a == "--batch" || a == "--output-dir" || a == "--output-suffix" || a == "--emit" ||
+                   a == "--section" || a == "--serve" || a == "--client") {
+            if (argc > i + 1) {
+                std::string& value = a == "--batch" ? batchList : a == "--output-dir" ? outputDir
+                                   : a == "--output-suffix" ? outputSuffix : a == "--emit" ? emit
+                                   : a == "--section" ? section : a == "--serve" ? servePath : clientPath;
+                value = argv[++i];
             }
             else {
                 usageExit(progName, -1);
@@ -61,13 +327,125 @@ int main(int argc, char** argv) {
             noColor = true;
         } else if (a == "--no-urls") {
             noUrls = true;
-        } else if (a == "-" ) {
-            file = "-";
+        } else if (a == "--cache") {
+            useCache = true;
+        } else if (a == "--watch") {
+            watch = true;
+        } else if (a == "--builtin-pager") {
+            builtinPager = true;
+        } else if (a == "--toc") {
+            toc = true;
+        } else if (a == "--line-buffered") {
+            lineBuffered = true;
+        } else if (a == "--stats" || a == "--stats=json") {
+            stats = true;
+            statsJson = a == "--stats=json";
         } else {
-            file = a;
+            files.push_back(a);
         }
     }
 
+    mdmni::RenderOptions opts;
+    opts.useColor = !noColor;
+    opts.showUrls = !noUrls;
+    opts.wrap = wrap;
+    opts.tableRowLimit = tableRows;
+
+    if (stats && !mdmni::StatsCompiled) {
+        std::cerr << "mdmni: --stats is not available in this build" << std::endl;
+        return 2;
+    }
+    mdmni::RenderStats renderStats;
+    mdmni::RenderStats* statsOut = stats ? &renderStats : nullptr;
+    countAllocations = stats;
+
+    // One parse, several outputs; other modes need nothing but ANSI
+    if (!emit.empty()) {
+        if (files.size() > 1) {
+            std::cerr << "mdmni: --emit takes one input" << std::endl;
+            return 2;
+        }
+        int status = emitOutputs(emit, files.empty() ? "" : files[0], opts, statsOut);
+        if (stats) reportStats(renderStats, statsJson);
+        return status;
+    }
+
+    // Server and client: the document crosses the socket whole, and the
+    // server keeps its renderers warm between requests
+    if (!servePath.empty()) {
+        if (!files.empty()) {
+            std::cerr << "mdmni: --serve takes no input files" << std::endl;
+            return 2;
+        }
+        return serve(servePath, jobsSet ? jobs : std::max(1u, std::thread::hardware_concurrency()));
+    }
+    if (!clientPath.empty()) {
+        if (files.size() > 1) {
+            std::cerr << "mdmni: --client takes one input" << std::endl;
+            return 2;
+        }
+        return renderRemote(clientPath, files.empty() ? "" : files[0], opts);
+    }
+
+    // Batch mode: every file is rendered to its own output file on a pool of
+    // threads, one per core unless -j says otherwise
+    if (!batchList.empty() || !outputDir.empty() || !outputSuffix.empty()) {
+        if (!batchList.empty()) {
+            std::ifstream list(batchList);
+            if (!list) {
+                std::cerr << "mdmni: cannot read file list: " << batchList << std::endl;
+                return 2;
+            }
+            for (std::string path; std::getline(list, path);) {
+                if (!path.empty() && path.back() == '\r') path.pop_back();
+                if (!path.empty()) files.push_back(path);
+            }
+        }
+        if (outputSuffix.empty()) outputSuffix = ".txt";
+
+        std::vector<mdmni::BatchItem> items;
+        items.reserve(files.size());
+        for (const std::string& f : files) {
+            if (f == "-") {
+                std::cerr << "mdmni: stdin cannot be rendered in batch mode" << std::endl;
+                return 2;
+            }
+            items.push_back(mdmni::BatchItem{f, mdmni::batchOutputPath(f, outputDir, outputSuffix)});
+        }
+        if (!jobsSet) jobs = std::max(1u, std::thread::hardware_concurrency());
+
+        mdmni::BatchSummary sum = mdmni::renderBatch(items, opts, jobs, std::cerr, statsOut);
+        double seconds = std::max(sum.seconds, 1e-9);
+        std::fprintf(stderr, "mdmni: %zu files, %.1f MB in %.2f s (%.0f files/s, %.1f MB/s)",
+                     sum.rendered, sum.inputBytes / (1024.0 * 1024.0), sum.seconds,
+                     sum.rendered / seconds, sum.inputBytes / (1024.0 * 1024.0) / seconds);
+        if (sum.failed) std::fprintf(stderr, ", %zu failed", sum.failed);
+        std::fprintf(stderr, "\n");
+        if (stats) reportStats(renderStats, statsJson);
+        return sum.failed ? 1 : 0;
+    }
+
+    if (files.empty()) files.push_back("");
+
+    // The file is read rather than mapped: editors may rewrite it in place
+    if (watch) {
+        if (files.size() != 1 || files[0].empty() || files[0] == "-") {
+            std::cerr << "mdmni: --watch needs exactly one file" << std::endl;
+            return 2;
+        }
+        if (!isatty(STDOUT_FILENO)) {
+            std::cerr << "mdmni: --watch needs a terminal" << std::endl;
+            return 2;
+        }
+        mdmni::Pager pager(std::string_view(), opts, files[0]);
+        if (!wrapGiven) pager.wrapToTerminal();
+        if (!pager.watch(files[0])) {
+            std::cerr << "mdmni: cannot watch " << files[0] << ": " << std::strerror(errno) << std::endl;
+            return 2;
+        }
+        return pager.run() ? 0 : 2;
+    }
+
     // If invoked via a symlink named 'mdless', always enable paging.
     if (!paging && argc > 0) {
         std::string prog = argv[0];
@@ -76,30 +454,143 @@ int main(int argc, char** argv) {
         if (prog == "mdless") paging = true;
     }
 
-    std::vector<std::string> lines;
-    if (file.empty() || file == "-") {
-        std::string line;
-        while (std::getline(std::cin, line)) {
-            lines.push_back(line);
+    // Regular files are memory-mapped and split into lines in place; stdin and
+    // pipes are read in chunks. Either way lines are streamed straight into the
+    // renderer, so output appears as soon as each block completes.
+    int status = 0;
+    size_t nextFile = 0;
+    std::string currentFile;
+    std::unique_ptr<mdmni::InputSource> in;
+    auto openNext = [&]() {
+        while (!in && nextFile < files.size()) {
+            const std::string& file = files[nextFile++];
+            currentFile = file;
+            in = mdmni::InputSource::open(file);
+            if (!in) {
+                std::cerr << "mdmni: file not found: " << file << std::endl;
+                status = 2;
+            }
         }
-    } else {
-        std::ifstream in(file);
-        if (!in) {
-            std::cerr << "mdmni: file not found: " << file << std::endl;
+        return in != nullptr;
+    };
+    if (!openNext()) return status;
+
+    // --toc and --section only need the heading index, a line scan that
+    // parses nothing but heading lines; a section is then rendered on its own
+    std::string storage;
+    std::unique_ptr<mdmni::InputSource> consumed;
+    std::unique_ptr<mdmni::InputSource> whole;  // keeps a section's mapping alive
+    if (toc || !section.empty()) {
+        if (files.size() != 1) {
+            std::cerr << "mdmni: --toc and --section take one input" << std::endl;
+            return 2;
+        }
+        std::string_view doc = in->remaining(storage);
+        if (readFailed(in.get(), currentFile)) return 2;
+        mdmni::BlockIndex index(doc);
+        std::vector<mdmni::Section> outline = mdmni::buildOutline(index);
+        if (toc) {
+            std::string text;
+            mdmni::writeOutline(outline, text);
+            std::cout << text;
+            std::cout.flush();
+            return std::cout ? 0 : 2;
+        }
+        const mdmni::Section* found = mdmni::findSection(outline, section);
+        if (!found) {
+            std::cerr << "mdmni: no such section: " << section << std::endl;
             return 2;
         }
-        std::string line;
-        while (std::getline(in, line)) lines.push_back(line);
+        whole = std::move(in);
+        in = std::make_unique<mdmni::MemoryInput>(doc.substr(found->offset, found->end - found->offset));
     }
 
-    mdmni::Renderer r(!noColor, !noUrls, wrap);
+    mdmni::Renderer r(opts);
+    r.setStats(statsOut);
+    // Regular files are rendered with full buffering; pipes and terminals get
+    // each finished block shown before the renderer waits for more input.
+    auto setFlushPolicy = [&]() {
+        if (lineBuffered) r.setFlushPolicy(mdmni::FlushPolicy::Line);
+        else if (!in->complete()) r.setFlushPolicy(mdmni::FlushPolicy::Block);
+        else r.setFlushPolicy(mdmni::FlushPolicy::Full);
+    };
 
-    if (paging) {
-        // Render to a buffer then feed it to the pager (PAGER env or less -R).
-        std::ostringstream buf;
-        r.render(lines, buf);
-        std::string out = buf.str();
+    // The built-in pager indexes the document and renders only what is on
+    // screen; it needs the whole input in memory and a terminal to draw on.
+    if (builtinPager && files.size() == 1 && isatty(STDOUT_FILENO)) {
+        std::string_view doc = in->remaining(storage);
+        if (readFailed(in.get(), currentFile)) return 2;
+        const std::string& file = files[0];
+        mdmni::Pager pager(doc, opts, file.empty() || file == "-" ? "stdin" : file);
+        if (!wrapGiven) pager.wrapToTerminal();
+        if (pager.run()) return 0;
+        // No terminal to draw on after all: print it, keeping the mapping alive
+        consumed = std::move(in);
+        in = std::make_unique<mdmni::MemoryInput>(doc);
+    }
+
+    // Parallel rendering needs the whole input up front to find split points
+    auto renderStream = [&](std::ostream& out) {
+        if (jobs > 1) {
+            mdmni::renderParallel(in->remaining(storage), out, opts, jobs, statsOut);
+        } else {
+            r.render(*in, out);
+        }
+    };
+
+    // The cache is keyed on the input bytes, so it also needs the whole
+    // input. Hits are copied to fd in one go; misses are rendered to out and
+    // into a new cache entry at the same time.
+    auto renderOne = [&](std::ostream& out, int fd) {
+        if (!useCache) {
+            renderStream(out);
+            return;
+        }
+        std::string_view doc = in->remaining(storage);
+        consumed = std::move(in);
+        in = std::make_unique<mdmni::MemoryInput>(doc);
+        // Whatever was read is still shown, but never cached
+        if (consumed->error()) {
+            renderStream(out);
+            return;
+        }
+
+        uint64_t maxBytes = mdmni::RenderCache::DefaultMaxBytes;
+        if (const char* mb = std::getenv("MDMNI_CACHE_MAX_MB")) {
+            if (std::atoll(mb) > 0) maxBytes = static_cast<uint64_t>(std::atoll(mb)) * 1024 * 1024;
+        }
+        mdmni::RenderCache cache(mdmni::RenderCache::defaultDirectory(), maxBytes);
+        std::string key = mdmni::RenderCache::key(doc, opts);
+        out.flush();
+        if (cache.serve(key, fd)) return;
+
+        auto entry = cache.store(key);
+        if (!entry) {
+            renderStream(out);
+            return;
+        }
+        mdmni::TeeOStream tee(out, entry->stream());
+        renderStream(tee);
+        tee.flush();
+        // An entry is only kept if the whole document was delivered
+        if (tee) entry->commit();
+    };
+
+    // Several files are rendered one after another into the same output
+    auto renderTo = [&](std::ostream& out, int fd) {
+        do {
+            setFlushPolicy();
+            renderOne(out, fd);
+            if (readFailed(consumed ? consumed.get() : in.get(), currentFile)) status = 2;
+            in.reset();
+            consumed.reset();
+            storage.clear();
+        } while (out && openNext());
+    };
 
+    if (paging) {
+        // Start the pager first and stream rendered blocks into it as they are
+        // produced, so the first screen does not wait for the whole document.
         const char* pager_env = std::getenv("PAGER");
         std::string pager = pager_env && pager_env[0] ? pager_env : "less -R";
 
@@ -111,8 +602,9 @@ int main(int argc, char** argv) {
         execArgs.push_back(nullptr);
 
         int fds[2];
+        pid_t pid = -1;
         if (pipe(fds) == 0) {
-            pid_t pid = fork();
+            pid = fork();
             if (pid == 0) {
                 // child: replace stdin with read end of pipe, then exec pager
                 close(fds[1]);
@@ -120,31 +612,29 @@ int main(int argc, char** argv) {
                 close(fds[0]);
                 execvp(execArgs[0], execArgs.data());
                 _exit(127);
-            } else if (pid > 0) {
-                // parent: write rendered output into write end, then wait
-                close(fds[0]);
-                const char* data = out.data();
-                size_t remaining = out.size();
-                while (remaining > 0) {
-                    ssize_t n = write(fds[1], data, remaining);
-                    if (n <= 0) break;
-                    data += n;
-                    remaining -= static_cast<size_t>(n);
-                }
-                close(fds[1]);
-                int status;
-                waitpid(pid, &status, 0);
-            } else {
-                close(fds[0]);
-                close(fds[1]);
-                std::cout << out;
             }
+            close(fds[0]);
+            if (pid < 0) close(fds[1]);
+        }
+
+        if (pid > 0) {
+            // parent: render into the write end. If the user quits the pager
+            // early, writes fail with EPIPE and rendering stops.
+            signal(SIGPIPE, SIG_IGN);
+            {
+                mdmni::FdOStream pipeOut(fds[1]);
+                renderTo(pipeOut, fds[1]);
+            }
+            close(fds[1]);
+            int pagerStatus;
+            waitpid(pid, &pagerStatus, 0);
         } else {
             // fallback to stdout
-            std::cout << out;
+            renderTo(std::cout, STDOUT_FILENO);
         }
     } else {
-        r.render(lines, std::cout);
+        renderTo(std::cout, STDOUT_FILENO);
     }
-    return 0;
+    if (stats) reportStats(renderStats, statsJson);
+    return status;
 }